@@ -4,339 +4,4582 @@
 #ifndef __FUNCTOR2C_HPP__
 #define __FUNCTOR2C_HPP__
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <iterator>
+#include <memory>
+#if __cplusplus >= 201703L
+	#if __has_include(<memory_resource>)
+		#include <memory_resource>
+		#define FUNCTOR2C_HAS_MEMORY_RESOURCE
+	#endif
+#endif
+#if __cplusplus >= 201703L
+	#if __has_include(<string_view>)
+		#include <string_view>
+		#define FUNCTOR2C_HAS_STRING_VIEW
+	#endif
+#endif
+#if __cplusplus >= 202002L
+	#if __has_include(<span>)
+		#include <span>
+		#define FUNCTOR2C_HAS_SPAN
+	#endif
+#endif
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
+#ifdef FUNCTOR2C_ASYNC
+	#include <chrono>
+	#include <condition_variable>
+	#include <thread>
+#endif
+#if defined(FUNCTOR2C_CLOSURE) && (defined(__x86_64__) || defined(__aarch64__)) && defined(__linux__)
+	#include <cstdio>
+	#include <sys/mman.h>
+	#include <unistd.h>
+	#define FUNCTOR2C_HAS_CLOSURE
+#endif
+
+namespace functor2c {
+
+/**
+ * Static descriptor with every operation available for a wrapped functor type.
+ *
+ * A single instance exists per functor type and userdata layout, so storing one pointer to it
+ * is enough to invoke, destroy and clone userdata.
+ */
+template<typename Invoker>
+struct function_vtable {
+	/// Invoker function, with userdata as prefix or suffix argument.
+	Invoker invoke;
+	/// Deleter function, for reclaiming memory allocated for userdata.
+	void (*destroy)(void*);
+	/// Clone function, returning a new userdata with a copy of the functor, or `nullptr` if the functor is not copyable.
+	void *(*clone)(const void*);
+	/// Number of bytes allocated for each userdata, 0 if the functor is stored directly in the userdata pointer.
+	std::size_t size;
+};
+
+/**
+ * Whether invoking a `const Fn` never changes its state, so that it can be packed inside the userdata pointer.
+ *
+ * This holds by default for function pointers and for lambdas with captures, whose closure types are not copy assignable
+ * and may only change their captures when declared `mutable`, in which case they are not invocable as `const`.
+ * Other functor types may have `mutable` members, so specialize this as `std::true_type` for small trivially copyable types
+ * known to have none to pack them too.
+ */
+template<typename Fn>
+struct is_packable : std::integral_constant<bool, std::is_pointer<Fn>::value || (std::is_class<Fn>::value && !std::is_copy_assignable<Fn>::value)> {};
+
+namespace detail {
+
+/**
+ * Static vtables for a wrapper type.
+ * @private
+ */
+template<typename Wrapper, typename RetType, typename... Args>
+struct wrapper_vtable {
+	static constexpr function_vtable<RetType (*)(void*, Args...)> prefix = { Wrapper::invoke_prefix, Wrapper::destroy, Wrapper::clone_function(), Wrapper::size };
+	static constexpr function_vtable<RetType (*)(Args..., void*)> suffix = { Wrapper::invoke_suffix, Wrapper::destroy, Wrapper::clone_function(), Wrapper::size };
+};
+
+template<typename Wrapper, typename RetType, typename... Args>
+constexpr function_vtable<RetType (*)(void*, Args...)> wrapper_vtable<Wrapper, RetType, Args...>::prefix;
+template<typename Wrapper, typename RetType, typename... Args>
+constexpr function_vtable<RetType (*)(Args..., void*)> wrapper_vtable<Wrapper, RetType, Args...>::suffix;
+
+/**
+ * How each argument is passed to batch invokers: a pointer to an array of elements.
+ * Arguments taken by value or const reference are read from const arrays,
+ * while elements of arrays passed for non-const references may be modified, or moved from for rvalue references.
+ * @private
+ */
+template<typename Arg>
+struct batch_argument {
+	using pointer = const typename std::decay<Arg>::type*;
+	static const typename std::decay<Arg>::type& get(pointer array, std::size_t index) {
+		return array[index];
+	}
+};
+
+template<typename Arg>
+struct batch_argument<Arg&> {
+	using pointer = Arg*;
+	static Arg& get(pointer array, std::size_t index) {
+		return array[index];
+	}
+};
+
+template<typename Arg>
+struct batch_argument<Arg&&> {
+	using pointer = Arg*;
+	static Arg&& get(pointer array, std::size_t index) {
+		return std::move(array[index]);
+	}
+};
+
+/**
+ * Batch invokers for the signature `RetType(Args...)`, which call the wrapped functor once per element of the argument arrays,
+ * storing results in the `out` array.
+ * Elements are passed by reference to the wrapper's `invoke`, which the compiler may inline to vectorize the loop,
+ * so they are never copied unless the functor takes them by value.
+ * @private
+ */
+template<typename RetType, typename... Args>
+struct batch_signature {
+	using prefix_pointer = void (*)(void*, typename batch_argument<Args>::pointer..., std::size_t, RetType*);
+	using suffix_pointer = void (*)(typename batch_argument<Args>::pointer..., std::size_t, RetType*, void*);
+
+	template<typename Wrapper>
+	static void invoke_prefix(void *userdata, typename batch_argument<Args>::pointer... arrays, std::size_t count, RetType *out) {
+		for (std::size_t i = 0; i < count; i++) {
+			out[i] = Wrapper::invoke(userdata, batch_argument<Args>::get(arrays, i)...);
+		}
+	}
+
+	template<typename Wrapper>
+	static void invoke_suffix(typename batch_argument<Args>::pointer... arrays, std::size_t count, RetType *out, void *userdata) {
+		invoke_prefix<Wrapper>(userdata, arrays..., count, out);
+	}
+};
+
+template<typename... Args>
+struct batch_signature<void, Args...> {
+	using prefix_pointer = void (*)(void*, typename batch_argument<Args>::pointer..., std::size_t);
+	using suffix_pointer = void (*)(typename batch_argument<Args>::pointer..., std::size_t, void*);
+
+	template<typename Wrapper>
+	static void invoke_prefix(void *userdata, typename batch_argument<Args>::pointer... arrays, std::size_t count) {
+		for (std::size_t i = 0; i < count; i++) {
+			Wrapper::invoke(userdata, batch_argument<Args>::get(arrays, i)...);
+		}
+	}
+
+	template<typename Wrapper>
+	static void invoke_suffix(typename batch_argument<Args>::pointer... arrays, std::size_t count, void *userdata) {
+		invoke_prefix<Wrapper>(userdata, arrays..., count);
+	}
+};
+
+/**
+ * Helper methods to get invoker/deleter function pointers for a wrapper type.
+ *
+ * `Wrapper` must provide static `create`, `create_shared`, `invoke_prefix`, `invoke_suffix` and `destroy` functions,
+ * plus `invoke` for batch invokers and wrappers of wrappers, `retain` for the reference counted builders and `clone_function` and `size` for the vtable builders.
+ * Builders optionally accept an allocator, which is forwarded to `create` and `create_shared`.
+ * @private
+ */
+template<typename Wrapper, typename RetType, typename... Args>
+struct invoker_factory {
+	/**
+	 * Deleter used to wrap userdata in `std::unique_ptr`.
+	 * @private
+	 */
+	struct deleter {
+		void operator()(void *userdata) const {
+			Wrapper::destroy(userdata);
+		}
+	};
+
+	template<typename Fn, typename... Alloc>
+	static std::tuple<void*, RetType (*)(void*, Args...)> prefix_invoker(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(Wrapper::create(std::forward<Fn>(fn), alloc...), Wrapper::invoke_prefix);
+	}
+	template<typename Fn, typename... Alloc>
+	static std::tuple<void*, RetType (*)(void*, Args...), void (*)(void*)> prefix_invoker_deleter(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(Wrapper::create(std::forward<Fn>(fn), alloc...), Wrapper::invoke_prefix, Wrapper::destroy);
+	}
+	template<typename Fn, typename... Alloc>
+	static std::tuple<std::unique_ptr<void, deleter>, RetType (*)(void*, Args...)> prefix_invoker_unique(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(std::unique_ptr<void, deleter>(Wrapper::create(std::forward<Fn>(fn), alloc...)), Wrapper::invoke_prefix);
+	}
+	template<typename Fn, typename... Alloc>
+	static std::tuple<std::shared_ptr<void>, RetType (*)(void*, Args...)> prefix_invoker_shared(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(Wrapper::create_shared(std::forward<Fn>(fn), alloc...), Wrapper::invoke_prefix);
+	}
+
+	template<typename Fn, typename... Alloc>
+	static std::tuple<RetType (*)(Args..., void*), void*> suffix_invoker(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(Wrapper::invoke_suffix, Wrapper::create(std::forward<Fn>(fn), alloc...));
+	}
+	template<typename Fn, typename... Alloc>
+	static std::tuple<RetType (*)(Args..., void*), void*, void (*)(void*)> suffix_invoker_deleter(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(Wrapper::invoke_suffix, Wrapper::create(std::forward<Fn>(fn), alloc...), Wrapper::destroy);
+	}
+	template<typename Fn, typename... Alloc>
+	static std::tuple<RetType (*)(Args..., void*), std::unique_ptr<void, deleter>> suffix_invoker_unique(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(Wrapper::invoke_suffix, std::unique_ptr<void, deleter>(Wrapper::create(std::forward<Fn>(fn), alloc...)));
+	}
+	template<typename Fn, typename... Alloc>
+	static std::tuple<RetType (*)(Args..., void*), std::shared_ptr<void>> suffix_invoker_shared(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(Wrapper::invoke_suffix, Wrapper::create_shared(std::forward<Fn>(fn), alloc...));
+	}
+	template<typename Fn, typename... Alloc>
+	static std::tuple<void*, const function_vtable<RetType (*)(void*, Args...)>*> prefix_invoker_vtable(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(Wrapper::create(std::forward<Fn>(fn), alloc...), &wrapper_vtable<Wrapper, RetType, Args...>::prefix);
+	}
+	template<typename Fn, typename... Alloc>
+	static std::tuple<const function_vtable<RetType (*)(Args..., void*)>*, void*> suffix_invoker_vtable(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(&wrapper_vtable<Wrapper, RetType, Args...>::suffix, Wrapper::create(std::forward<Fn>(fn), alloc...));
+	}
+	template<typename Fn, typename... Alloc>
+	static std::tuple<void*, RetType (*)(void*, Args...), typename batch_signature<RetType, Args...>::prefix_pointer, void (*)(void*)> prefix_invoker_batch(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(Wrapper::create(std::forward<Fn>(fn), alloc...), Wrapper::invoke_prefix, batch_signature<RetType, Args...>::template invoke_prefix<Wrapper>, Wrapper::destroy);
+	}
+	template<typename Fn, typename... Alloc>
+	static std::tuple<RetType (*)(Args..., void*), void*, typename batch_signature<RetType, Args...>::suffix_pointer, void (*)(void*)> suffix_invoker_batch(Fn&& fn, const Alloc&... alloc) {
+		return std::make_tuple(Wrapper::invoke_suffix, Wrapper::create(std::forward<Fn>(fn), alloc...), batch_signature<RetType, Args...>::template invoke_suffix<Wrapper>, Wrapper::destroy);
+	}
+	template<typename Fn>
+	static std::tuple<void*, RetType (*)(void*, Args...), void (*)(void*), void (*)(void*)> prefix_invoker_refcounted(Fn&& fn) {
+		return std::make_tuple(Wrapper::create(std::forward<Fn>(fn)), Wrapper::invoke_prefix, Wrapper::retain, Wrapper::destroy);
+	}
+	template<typename Fn>
+	static std::tuple<RetType (*)(Args..., void*), void*, void (*)(void*), void (*)(void*)> suffix_invoker_refcounted(Fn&& fn) {
+		return std::make_tuple(Wrapper::invoke_suffix, Wrapper::create(std::forward<Fn>(fn)), Wrapper::retain, Wrapper::destroy);
+	}
+};
+
+/**
+ * Whether `T` can be used as an empty base class.
+ * @private
+ */
+template<typename T>
+struct is_empty_base : std::integral_constant<bool, std::is_empty<T>::value
+#if __cplusplus >= 201402L
+	&& !std::is_final<T>::value
+#endif
+> {};
+
+/**
+ * Holds an allocator instance, taking no space at all for stateless allocators.
+ * @private
+ */
+template<typename Alloc, bool = is_empty_base<Alloc>::value>
+struct allocator_holder : private Alloc {
+	allocator_holder(const Alloc& alloc) : Alloc(alloc) {}
+
+	const Alloc& get_allocator() const {
+		return *this;
+	}
+};
+
+template<typename Alloc>
+struct allocator_holder<Alloc, false> {
+	allocator_holder(const Alloc& alloc) : allocator(alloc) {}
+
+	const Alloc& get_allocator() const {
+		return allocator;
+	}
+
+private:
+	Alloc allocator;
+};
+
+/**
+ * Holds a functor instance, taking no space at all for stateless functors.
+ * @private
+ */
+template<typename Fn, bool = is_empty_base<Fn>::value>
+struct functor_holder : private Fn {
+	template<typename F>
+	explicit functor_holder(F&& fn) : Fn(std::forward<F>(fn)) {}
+
+	Fn& get_functor() {
+		return *this;
+	}
+
+	const Fn& get_functor() const {
+		return *this;
+	}
+};
+
+template<typename Fn>
+struct functor_holder<Fn, false> {
+	template<typename F>
+	explicit functor_holder(F&& fn) : functor(std::forward<F>(fn)) {}
+
+	Fn& get_functor() {
+		return functor;
+	}
+
+	const Fn& get_functor() const {
+		return functor;
+	}
+
+private:
+	Fn functor;
+};
+
+/**
+ * Wrapper for a functor of concrete type `Fn` with helper methods to get invoker/deleter function pointers.
+ *
+ * Storing the functor type directly, instead of erasing it behind a `std::function`,
+ * makes invokers call `Fn` without any additional indirection and wrappers cost a single allocation.
+ * Memory is allocated using `Alloc`, which is stored in the wrapper so that the deleter can give memory back to it.
+ * @private
+ */
+template<bool destroy_on_invoke, typename Fn, typename Alloc, typename RetType, typename... Args>
+struct destroyable_function : invoker_factory<destroyable_function<destroy_on_invoke, Fn, Alloc, RetType, Args...>, RetType, Args...>, private allocator_holder<Alloc> {
+	template<typename F>
+	destroyable_function(F&& fn, const Alloc& alloc) : allocator_holder<Alloc>(alloc), function(std::forward<F>(fn)) {}
+
+	template<typename... Params>
+	RetType operator()(Params&&... params) {
+		destroy_guard destroyer { destroy_on_invoke ? this : nullptr };
+		return function(std::forward<Params>(params)...);
+	}
+
+	template<typename F>
+	static void *create(F&& fn, const Alloc& alloc = Alloc()) {
+		node_allocator allocator(alloc);
+		allocation_guard guard { allocator, node_traits::allocate(allocator, 1) };
+		node_traits::construct(allocator, guard.pointer, std::forward<F>(fn), alloc);
+		return static_cast<void*>(guard.release());
+	}
+
+	static RetType invoke_prefix(void *userdata, Args... args) {
+		return invoke(userdata, std::forward<Args>(args)...);
+	}
+
+	static RetType invoke_suffix(Args... args, void *userdata) {
+		return invoke(userdata, std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Invoke the functor with arguments already materialized by the caller, like the C-facing invokers or batch invokers.
+	 * Every hop takes arguments by reference, so they are never copied or moved on the way to the functor.
+	 */
+	template<typename... Params>
+	static RetType invoke(void *userdata, Params&&... params) {
+		auto self = static_cast<destroyable_function*>(userdata);
+		return (*self)(std::forward<Params>(params)...);
+	}
+
+	static void destroy(void *userdata) {
+		auto self = static_cast<destroyable_function*>(userdata);
+		node_allocator allocator(self->get_allocator());
+		node_traits::destroy(allocator, self);
+		node_traits::deallocate(allocator, self, 1);
+	}
+
+	static constexpr std::size_t size = sizeof(destroyable_function);
+
+	static constexpr void *(*clone_function())(const void*) {
+		return clone_function(std::is_copy_constructible<Fn>());
+	}
+
+	template<typename F>
+	static std::shared_ptr<void> create_shared(F&& fn, const Alloc& alloc = Alloc()) {
+		// Functor and control block share a single allocation
+		return std::allocate_shared<destroyable_function>(node_allocator(alloc), std::forward<F>(fn), alloc);
+	}
+
+private:
+	using node_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<destroyable_function>;
+	using node_traits = std::allocator_traits<node_allocator>;
+
+	/// Deallocates memory on scope exit, unless released.
+	struct allocation_guard {
+		node_allocator& allocator;
+		destroyable_function *pointer;
+
+		~allocation_guard() {
+			if (pointer) {
+				node_traits::deallocate(allocator, pointer, 1);
+			}
+		}
+
+		destroyable_function *release() {
+			destroyable_function *released = pointer;
+			pointer = nullptr;
+			return released;
+		}
+	};
+
+	static constexpr void *(*clone_function(std::true_type))(const void*) {
+		return clone;
+	}
+	static constexpr void *(*clone_function(std::false_type))(const void*) {
+		return nullptr;
+	}
+
+	static void *clone(const void *userdata) {
+		auto self = static_cast<const destroyable_function*>(userdata);
+		return create(self->function, self->get_allocator());
+	}
+
+	/// Destroys the wrapper on scope exit, used by oneshot invokers.
+	struct destroy_guard {
+		destroyable_function *self;
+
+		~destroy_guard() {
+			if (self) {
+				destroy(self);
+			}
+		}
+	};
+
+	Fn function;
+};
+
+/**
+ * Whether `Fn` is stateless, so that it can be invoked without any userdata.
+ * This is the case for captureless lambdas and empty functor objects.
+ * @private
+ */
+template<typename Fn>
+struct is_empty_function : std::integral_constant<bool, std::is_empty<Fn>::value && std::is_trivially_copyable<Fn>::value> {};
+
+/**
+ * Wrapper for stateless functors that requires no allocation at all.
+ *
+ * Userdata is always `nullptr` and the deleter is a no-op.
+ * Since `Fn` is empty and trivially copyable, invokers use a static copy of the first wrapped functor, which holds no state.
+ * @private
+ */
+template<typename Fn, typename RetType, typename... Args>
+struct empty_function : invoker_factory<empty_function<Fn, RetType, Args...>, RetType, Args...> {
+	template<typename F, typename... Alloc>
+	static void *create(F&& fn, const Alloc&...) {
+		construct(fn);
+		return nullptr;
+	}
+
+	static RetType invoke_prefix(void *, Args... args) {
+		return instance()(std::forward<Args>(args)...);
+	}
+
+	static RetType invoke_suffix(Args... args, void *) {
+		return instance()(std::forward<Args>(args)...);
+	}
+
+	template<typename... Params>
+	static RetType invoke(void *, Params&&... params) {
+		return instance()(std::forward<Params>(params)...);
+	}
+
+	static void retain(void *) {}
+	static void destroy(void *) {}
+
+	static constexpr std::size_t size = 0;
+
+	static constexpr void *(*clone_function())(const void*) {
+		return clone;
+	}
+
+	static void *clone(const void *userdata) {
+		return const_cast<void*>(userdata);
+	}
+
+	template<typename F, typename... Alloc>
+	static std::shared_ptr<void> create_shared(F&& fn, const Alloc&...) {
+		create(std::forward<F>(fn));
+		return std::shared_ptr<void>();
+	}
+
+private:
+	/**
+	 * Storage for the static instance, constructed from `fn` by `create`, which every invoker is obtained after.
+	 * Constant initialization keeps guard checks out of invokers, so batch invokers may still vectorize.
+	 */
+	union storage {
+		constexpr storage() : empty() {}
+
+		char empty;
+		Fn value;
+	};
+
+	static Fn& instance() {
+		return holder.value;
+	}
+
+	/// Construct the static instance from the first wrapped functor only, so it is never constructed while invokers use it.
+	static void construct(const Fn& fn) {
+		static const bool constructed = (new (&holder.value) Fn(fn), true);
+		(void) constructed;
+	}
+
+	static storage holder;
+};
+template<typename Fn, typename RetType, typename... Args>
+typename empty_function<Fn, RetType, Args...>::storage empty_function<Fn, RetType, Args...>::holder;
+
+/**
+ * Whether a `const Fn` can be invoked with `Args`.
+ * Notice that `mutable` members may still change inside a `const` invocation.
+ * @private
+ */
+template<typename Fn, typename Enable, typename... Args>
+struct is_const_invocable_impl : std::false_type {};
+
+template<typename Fn, typename... Args>
+struct is_const_invocable_impl<Fn, decltype(void(std::declval<const Fn&>()(std::declval<Args>()...))), Args...> : std::true_type {};
+
+template<typename Fn, typename... Args>
+struct is_const_invocable : is_const_invocable_impl<Fn, void, Args...> {};
+
+/**
+ * Whether `Fn` can be stored directly inside the userdata pointer bits.
+ *
+ * This is the case for trivially copyable functors that fit in a `void*`, like lambdas capturing a single pointer or plain function pointers.
+ * Since invokers work on a copy of the packed bits, only functors that are invocable as `const` and `is_packable` are packed.
+ * @private
+ */
+template<typename Fn, typename... Args>
+struct is_packed_function : std::integral_constant<bool,
+	sizeof(Fn) <= sizeof(void*)
+	&& alignof(Fn) <= alignof(void*)
+	&& std::is_trivially_copyable<Fn>::value
+	&& is_const_invocable<Fn, Args...>::value
+	&& is_packable<Fn>::value
+> {};
+
+/**
+ * Wrapper for small trivially copyable functors, which are bit-copied into the userdata itself.
+ *
+ * No memory is allocated and the deleter is a no-op.
+ * @private
+ */
+template<typename Fn, typename RetType, typename... Args>
+struct packed_function : invoker_factory<packed_function<Fn, RetType, Args...>, RetType, Args...> {
+	template<typename F, typename... Alloc>
+	static void *create(F&& fn, const Alloc&...) {
+		void *userdata = nullptr;
+		std::memcpy(&userdata, std::addressof(fn), sizeof(Fn));
+		return userdata;
+	}
+
+	static RetType invoke_prefix(void *userdata, Args... args) {
+		storage fn(userdata);
+		return fn.get()(std::forward<Args>(args)...);
+	}
+
+	static RetType invoke_suffix(Args... args, void *userdata) {
+		storage fn(userdata);
+		return fn.get()(std::forward<Args>(args)...);
+	}
+
+	template<typename... Params>
+	static RetType invoke(void *userdata, Params&&... params) {
+		storage fn(userdata);
+		return fn.get()(std::forward<Params>(params)...);
+	}
+
+	static void retain(void *) {}
+	static void destroy(void *) {}
+
+	static constexpr std::size_t size = 0;
+
+	static constexpr void *(*clone_function())(const void*) {
+		return clone;
+	}
+
+	static void *clone(const void *userdata) {
+		return const_cast<void*>(userdata);
+	}
+
+	template<typename F, typename... Alloc>
+	static std::shared_ptr<void> create_shared(F&& fn, const Alloc&...) {
+		// Aliasing constructor with an empty owner: no control block is allocated
+		return std::shared_ptr<void>(std::shared_ptr<void>(), create(std::forward<F>(fn)));
+	}
+
+private:
+	struct storage {
+		storage(void *userdata) {
+			std::memcpy(&bytes, &userdata, sizeof(void*));
+		}
+
+		const Fn& get() const {
+			return *reinterpret_cast<const Fn*>(&bytes);
+		}
+
+		alignas(void*) unsigned char bytes[sizeof(void*)];
+	};
+};
+
+/**
+ * Wrapper type used for `Fn` with the given signature, selected at compile time.
+ * @private
+ */
+template<bool destroy_on_invoke, typename Fn, typename Alloc, typename RetType, typename... Args>
+using function_wrapper = typename std::conditional<
+	is_empty_function<Fn>::value,
+	empty_function<Fn, RetType, Args...>,
+	typename std::conditional<
+		is_packed_function<Fn, Args...>::value,
+		packed_function<Fn, RetType, Args...>,
+		destroyable_function<destroy_on_invoke, Fn, Alloc, RetType, Args...>
+	>::type
+>::type;
+
+/**
+ * Wrapper type used to wrap `Fn` with the given signature.
+ * @private
+ */
+template<bool destroy_on_invoke, typename Fn, typename RetType, typename... Args>
+using function_wrapper_for = function_wrapper<destroy_on_invoke, typename std::decay<Fn>::type, std::allocator<char>, RetType, Args...>;
+
+/**
+ * Wrapper for a functor with an intrusive reference count, for C APIs that expect ref/unref callbacks.
+ *
+ * The count lives in the same allocation as the functor and starts at 1.
+ * `retain` increments it, `destroy` decrements it and deletes the wrapper when it reaches zero.
+ * @private
+ */
+template<typename Policy, typename Fn, typename RetType, typename... Args>
+struct refcounted_function : invoker_factory<refcounted_function<Policy, Fn, RetType, Args...>, RetType, Args...> {
+	template<typename F>
+	refcounted_function(F&& fn) : count(1), function(std::forward<F>(fn)) {}
+
+	template<typename F>
+	static void *create(F&& fn) {
+		return static_cast<void*>(new refcounted_function(std::forward<F>(fn)));
+	}
+
+	static RetType invoke_prefix(void *userdata, Args... args) {
+		auto self = static_cast<refcounted_function*>(userdata);
+		return self->function(std::forward<Args>(args)...);
+	}
+
+	static RetType invoke_suffix(Args... args, void *userdata) {
+		auto self = static_cast<refcounted_function*>(userdata);
+		return self->function(std::forward<Args>(args)...);
+	}
+
+	static RetType invoke(void *userdata, Args&&... args) {
+		auto self = static_cast<refcounted_function*>(userdata);
+		return self->function(std::forward<Args>(args)...);
+	}
+
+	static void retain(void *userdata) {
+		auto self = static_cast<refcounted_function*>(userdata);
+		Policy::increment(self->count);
+	}
+
+	static void destroy(void *userdata) {
+		auto self = static_cast<refcounted_function*>(userdata);
+		if (Policy::decrement(self->count)) {
+			delete self;
+		}
+	}
+
+private:
+	typename Policy::counter_type count;
+	Fn function;
+};
+
+/**
+ * Reference counted wrapper type used to wrap `Fn` with the given signature.
+ * Functors that require no allocation ignore reference counting altogether.
+ * @private
+ */
+template<typename Policy, typename Fn, typename RetType, typename... Args>
+using refcounted_function_wrapper_for = typename std::conditional<
+	is_empty_function<typename std::decay<Fn>::type>::value,
+	empty_function<typename std::decay<Fn>::type, RetType, Args...>,
+	typename std::conditional<
+		is_packed_function<typename std::decay<Fn>::type, Args...>::value,
+		packed_function<typename std::decay<Fn>::type, RetType, Args...>,
+		refcounted_function<Policy, typename std::decay<Fn>::type, RetType, Args...>
+	>::type
+>::type;
+
+/**
+ * Whether `T` is a `std::function`, whose type erasure may allocate and throw.
+ * @private
+ */
+template<typename T>
+struct is_std_function : std::false_type {};
+
+template<typename Signature>
+struct is_std_function<std::function<Signature>> : std::true_type {};
+
+/**
+ * Marks the current thread as running a realtime invoker, for the debug allocation trap.
+ * @private
+ */
+struct realtime_scope {
+#ifdef FUNCTOR2C_REALTIME_ALLOCATION_TRAP
+	realtime_scope() noexcept {
+		depth()++;
+	}
+	~realtime_scope() {
+		depth()--;
+	}
+
+	static int& depth() noexcept {
+		static thread_local int value = 0;
+		return value;
+	}
+#else
+	realtime_scope() noexcept {}
+#endif
+};
+
+/**
+ * Wrapper used by realtime invokers, checking at compile time that invoking `Fn` cannot throw.
+ * @private
+ */
+template<typename Fn, typename RetType, typename... Args>
+struct realtime_function : invoker_factory<realtime_function<Fn, RetType, Args...>, RetType, Args...> {
+	using wrapper = function_wrapper_for<false, Fn, RetType, Args...>;
+
+	static_assert(!is_std_function<Fn>::value, "std::function is not allowed in realtime invokers, since it may allocate and throw");
+	static_assert(noexcept(std::declval<Fn&>()(std::declval<Args>()...)), "Functors used in realtime invokers must be noexcept");
+
+	template<typename F>
+	static void *create(F&& fn) {
+		return wrapper::create(std::forward<F>(fn));
+	}
+
+	static RetType invoke_prefix(void *userdata, Args... args) noexcept {
+		return invoke(userdata, std::forward<Args>(args)...);
+	}
+
+	static RetType invoke_suffix(Args... args, void *userdata) noexcept {
+		return invoke(userdata, std::forward<Args>(args)...);
+	}
+
+	static RetType invoke(void *userdata, Args&&... args) noexcept {
+		realtime_scope scope;
+		return wrapper::invoke(userdata, std::forward<Args>(args)...);
+	}
+
+	static void destroy(void *userdata) {
+		wrapper::destroy(userdata);
+	}
+};
+
+/**
+ * Type list used for manipulating argument packs.
+ * @private
+ */
+template<typename... Types>
+struct type_list {};
+
+/**
+ * Functor that adapts C arguments `Args` to the parameters of `Fn`, like pointer plus size pairs into views.
+ * @private
+ */
+template<typename Fn, typename RetType, typename... Args>
+struct adapted_function;
+
+/**
+ * Removes the `void*` userdata from the end of `Args` of a C function type.
+ * @private
+ */
+template<typename RetType, typename Done, typename... Args>
+struct suffix_c_signature;
+
+template<typename RetType, typename... Args>
+struct suffix_c_signature<RetType, type_list<Args...>, void*> {
+	template<bool destroy_on_invoke, typename Fn>
+	using wrapper = function_wrapper_for<destroy_on_invoke, Fn, RetType, Args...>;
+
+	template<typename Fn>
+	static std::tuple<RetType (*)(Args..., void*), void*, void (*)(void*)> adapted_invoker_deleter(Fn&& fn) {
+		using adapted = adapted_function<typename std::decay<Fn>::type, RetType, Args...>;
+		return function_wrapper_for<false, adapted, RetType, Args...>::suffix_invoker_deleter(adapted(std::forward<Fn>(fn)));
+	}
+};
+
+template<typename RetType, typename... Done, typename Next, typename... Args>
+struct suffix_c_signature<RetType, type_list<Done...>, Next, Args...> : suffix_c_signature<RetType, type_list<Done..., Next>, Args...> {};
+
+/**
+ * Signature information for C function types, or pointers to them, that accept a `void*` userdata as first parameter.
+ * @private
+ */
+template<typename CFunction>
+struct prefix_c_function;
+
+template<typename RetType, typename... Args>
+struct prefix_c_function<RetType(void*, Args...)> {
+	using pointer = RetType (*)(void*, Args...);
+
+	template<bool destroy_on_invoke, typename Fn>
+	using wrapper = function_wrapper_for<destroy_on_invoke, Fn, RetType, Args...>;
+
+	template<typename Fn>
+	static std::tuple<void*, pointer, void (*)(void*)> adapted_invoker_deleter(Fn&& fn) {
+		using adapted = adapted_function<typename std::decay<Fn>::type, RetType, Args...>;
+		return function_wrapper_for<false, adapted, RetType, Args...>::prefix_invoker_deleter(adapted(std::forward<Fn>(fn)));
+	}
+};
+
+template<typename RetType, typename... Args>
+struct prefix_c_function<RetType (*)(Args...)> : prefix_c_function<RetType(Args...)> {};
+
+/**
+ * Signature information for C function types, or pointers to them, that accept a `void*` userdata as last parameter.
+ * @private
+ */
+template<typename CFunction>
+struct suffix_c_function;
+
+template<typename RetType, typename... Args>
+struct suffix_c_function<RetType(Args...)> : suffix_c_signature<RetType, type_list<>, Args...> {
+	using pointer = RetType (*)(Args...);
+};
+
+template<typename RetType, typename... Args>
+struct suffix_c_function<RetType (*)(Args...)> : suffix_c_function<RetType(Args...)> {};
+
+/**
+ * Allocator type used for allocator arguments of type `Alloc`.
+ * Pointers to `std::pmr::memory_resource` are used through `std::pmr::polymorphic_allocator`.
+ * @private
+ */
+template<typename Alloc, typename Enable = void>
+struct allocator_for {
+	using type = Alloc;
+};
+
+#ifdef FUNCTOR2C_HAS_MEMORY_RESOURCE
+template<typename Resource>
+struct allocator_for<Resource*, typename std::enable_if<std::is_base_of<std::pmr::memory_resource, Resource>::value>::type> {
+	using type = std::pmr::polymorphic_allocator<char>;
+};
+#endif
+
+/**
+ * Wrapper type used to wrap `Fn` with the given signature, allocating memory with `Alloc`.
+ * @private
+ */
+template<bool destroy_on_invoke, typename Fn, typename Alloc, typename RetType, typename... Args>
+using allocated_function_wrapper_for = function_wrapper<destroy_on_invoke, typename std::decay<Fn>::type, typename allocator_for<Alloc>::type, RetType, Args...>;
+
+/**
+ * Non-owning reference to an existing functor, with static invokers that call it through the userdata pointer.
+ * @private
+ */
+template<typename Fn, typename RetType, typename... Args>
+struct function_ref {
+	static std::tuple<void*, RetType (*)(void*, Args...)> prefix_invoker(Fn& fn) {
+		return std::make_tuple(userdata(fn), invoke_prefix);
+	}
+	static std::tuple<RetType (*)(Args..., void*), void*> suffix_invoker(Fn& fn) {
+		return std::make_tuple(invoke_suffix, userdata(fn));
+	}
+
+	static RetType invoke_prefix(void *userdata, Args... args) {
+		return (*static_cast<Fn*>(userdata))(std::forward<Args>(args)...);
+	}
+
+	static RetType invoke_suffix(Args... args, void *userdata) {
+		return (*static_cast<Fn*>(userdata))(std::forward<Args>(args)...);
+	}
+
+	static RetType invoke(void *userdata, Args&&... args) {
+		return (*static_cast<Fn*>(userdata))(std::forward<Args>(args)...);
+	}
+
+private:
+	static void *userdata(Fn& fn) {
+		return const_cast<void*>(static_cast<const volatile void*>(std::addressof(fn)));
+	}
+};
+
+/**
+ * Forward an element of `Range`, moving from it if the range itself is an rvalue.
+ * @private
+ */
+template<typename Range, typename Element>
+typename std::conditional<std::is_lvalue_reference<Range>::value, Element&&, typename std::remove_reference<Element>::type&&>::type forward_element(Element&& element) {
+	return static_cast<typename std::conditional<std::is_lvalue_reference<Range>::value, Element&&, typename std::remove_reference<Element>::type&&>::type>(element);
+}
+
+/**
+ * Many functors of type `Fn` stored contiguously in a single allocation, right after the array of their userdata.
+ * @private
+ */
+template<typename Fn, typename RetType, typename... Args>
+struct many_function {
+	static_assert(alignof(Fn) <= alignof(std::max_align_t), "Over-aligned functors are not supported by make_many");
+
+	template<typename Range>
+	static std::tuple<void**, std::size_t, RetType (*)(void*, Args...), void (*)(void*)> prefix_invoker(Range&& range) {
+		void **userdatas = create(std::forward<Range>(range));
+		return std::make_tuple(userdatas, count(userdatas), function_ref<Fn, RetType, Args...>::invoke_prefix, destroy);
+	}
+
+	template<typename Range>
+	static std::tuple<RetType (*)(Args..., void*), void**, std::size_t, void (*)(void*)> suffix_invoker(Range&& range) {
+		void **userdatas = create(std::forward<Range>(range));
+		return std::make_tuple(function_ref<Fn, RetType, Args...>::invoke_suffix, userdatas, count(userdatas), destroy);
+	}
+
+	/// Destroy every functor, in reverse order, and free the whole block, given the userdata array.
+	static void destroy(void *userdatas) {
+		destroy_block(static_cast<char*>(userdatas) - header_size);
+	}
+
+private:
+	struct header {
+		std::size_t count;
+		std::size_t capacity;
+	};
+
+	static constexpr std::size_t header_size = (sizeof(header) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+	static std::size_t functors_offset(std::size_t capacity) {
+		return (header_size + capacity * sizeof(void*) + alignof(Fn) - 1) / alignof(Fn) * alignof(Fn);
+	}
+
+	/// Destroys the functors constructed so far if an exception is thrown.
+	struct construction_guard {
+		char *block;
+
+		~construction_guard() {
+			if (block) {
+				destroy_block(block);
+			}
+		}
+	};
+
+	static std::size_t count(void **userdatas) {
+		return reinterpret_cast<header*>(reinterpret_cast<char*>(userdatas) - header_size)->count;
+	}
+
+	template<typename Range>
+	static void **create(Range&& range) {
+		// The range is walked twice: once for sizing the allocation and once for constructing the functors
+		static_assert(std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<decltype(std::begin(range))>::iterator_category>::value, "make_many requires ranges with forward iterators");
+		std::size_t capacity = std::distance(std::begin(range), std::end(range));
+		char *block = static_cast<char*>(::operator new(functors_offset(capacity) + capacity * sizeof(Fn)));
+		header *h = new (block) header { 0, capacity };
+		construction_guard guard { block };
+		void **userdatas = reinterpret_cast<void**>(block + header_size);
+		Fn *functors = reinterpret_cast<Fn*>(block + functors_offset(capacity));
+		for (auto it = std::begin(range), end = std::end(range); it != end; ++it) {
+			userdatas[h->count] = new (functors + h->count) Fn(forward_element<Range>(*it));
+			h->count++;
+		}
+		guard.block = nullptr;
+		return userdatas;
+	}
+
+	static void destroy_block(char *block) {
+		header *h = reinterpret_cast<header*>(block);
+		Fn *functors = reinterpret_cast<Fn*>(block + functors_offset(h->capacity));
+		for (std::size_t i = h->count; i > 0; i--) {
+			functors[i - 1].~Fn();
+		}
+		::operator delete(block);
+	}
+};
+template<typename Fn, typename RetType, typename... Args>
+constexpr std::size_t many_function<Fn, RetType, Args...>::header_size;
+
+/**
+ * Type used for passing an argument of type `Arg` to each `multicast` handler.
+ * Arguments are passed as lvalues, since the same argument is passed to every handler,
+ * except for rvalue reference parameters, which are passed on as rvalue references.
+ * @private
+ */
+template<typename Arg>
+struct multicast_argument {
+	using type = Arg&;
+};
+
+template<typename Arg>
+struct multicast_argument<Arg&&> {
+	using type = Arg&&;
+};
+
+/**
+ * Type-erased operations of a handler stored inside a `multicast` snapshot buffer.
+ * @private
+ */
+template<typename RetType, typename... Args>
+struct multicast_ops {
+	RetType (*invoke)(void*, typename multicast_argument<Args>::type...);
+	void (*copy)(void*, const void*);
+	void (*destroy)(void*);
+	std::size_t offset;
+	std::size_t stride;
+};
+
+/**
+ * Header preceding each handler stored inside a `multicast` snapshot buffer.
+ * @private
+ */
+template<typename RetType, typename... Args>
+struct multicast_entry {
+	const multicast_ops<RetType, Args...> *ops;
+	std::size_t id;
+};
+
+/**
+ * Static operations for handlers of type `Fn`, laid out right after their entry header.
+ * Strides are multiples of the maximum alignment, so every entry in a buffer is suitably aligned.
+ * @private
+ */
+template<typename Fn, typename RetType, typename... Args>
+struct multicast_handler {
+	static RetType invoke(void *fn, typename multicast_argument<Args>::type... args) {
+		return (*static_cast<Fn*>(fn))(std::forward<typename multicast_argument<Args>::type>(args)...);
+	}
+
+	static void copy(void *destination, const void *source) {
+		new (destination) Fn(*static_cast<const Fn*>(source));
+	}
+
+	static void destroy(void *fn) {
+		static_cast<Fn*>(fn)->~Fn();
+	}
+
+	static constexpr std::size_t offset = (sizeof(multicast_entry<RetType, Args...>) + alignof(Fn) - 1) / alignof(Fn) * alignof(Fn);
+	static constexpr std::size_t stride = (offset + sizeof(Fn) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+	static constexpr multicast_ops<RetType, Args...> ops { invoke, copy, destroy, offset, stride };
+};
+template<typename Fn, typename RetType, typename... Args>
+constexpr std::size_t multicast_handler<Fn, RetType, Args...>::offset;
+template<typename Fn, typename RetType, typename... Args>
+constexpr std::size_t multicast_handler<Fn, RetType, Args...>::stride;
+template<typename Fn, typename RetType, typename... Args>
+constexpr multicast_ops<RetType, Args...> multicast_handler<Fn, RetType, Args...>::ops;
+
+template<typename Fn, typename RetType, typename... Args>
+struct realtime_function;
+
+template<typename Fn, typename RetType, typename... Args>
+struct many_function;
+
+template<typename Fn, typename Executor, typename... Args>
+struct async_function;
+
+/**
+ * Wrapper types for the signature `RetType(Args...)`.
+ * @private
+ */
+template<typename Signature>
+struct signature;
+
+template<typename RetType, typename... Args>
+struct signature<RetType(Args...)> {
+	using return_type = RetType;
+
+	template<bool destroy_on_invoke, typename Fn>
+	using wrapper = function_wrapper_for<destroy_on_invoke, Fn, RetType, Args...>;
+	template<bool destroy_on_invoke, typename Fn, typename Alloc>
+	using allocated_wrapper = allocated_function_wrapper_for<destroy_on_invoke, Fn, Alloc, RetType, Args...>;
+	template<typename Policy, typename Fn>
+	using refcounted_wrapper = refcounted_function_wrapper_for<Policy, Fn, RetType, Args...>;
+	template<typename Fn>
+	using reference = function_ref<Fn, RetType, Args...>;
+	template<typename Fn, typename Executor>
+	using async_wrapper = async_function<typename std::decay<Fn>::type, Executor, Args...>;
+	template<typename Fn>
+	using realtime_wrapper = realtime_function<typename std::decay<Fn>::type, RetType, Args...>;
+	template<typename Fn>
+	using many_wrapper = many_function<typename std::decay<Fn>::type, RetType, Args...>;
+};
+
+/**
+ * Helper for detecting well-formed types in partial specializations.
+ * @private
+ */
+template<typename... Types>
+struct make_void {
+	using type = void;
+};
+
+/**
+ * Signature of member function pointers, ignoring their class and qualifiers.
+ * @private
+ */
+template<typename MemberFunction>
+struct member_function_signature;
+
+template<typename Class, typename RetType, typename... Args>
+struct member_function_signature<RetType (Class::*)(Args...)> {
+	using type = RetType(Args...);
+};
+template<typename Class, typename RetType, typename... Args>
+struct member_function_signature<RetType (Class::*)(Args...) const> : member_function_signature<RetType (Class::*)(Args...)> {};
+template<typename Class, typename RetType, typename... Args>
+struct member_function_signature<RetType (Class::*)(Args...) &> : member_function_signature<RetType (Class::*)(Args...)> {};
+template<typename Class, typename RetType, typename... Args>
+struct member_function_signature<RetType (Class::*)(Args...) const &> : member_function_signature<RetType (Class::*)(Args...)> {};
+#if __cplusplus >= 201703L
+template<typename Class, typename RetType, typename... Args>
+struct member_function_signature<RetType (Class::*)(Args...) noexcept> : member_function_signature<RetType (Class::*)(Args...)> {};
+template<typename Class, typename RetType, typename... Args>
+struct member_function_signature<RetType (Class::*)(Args...) const noexcept> : member_function_signature<RetType (Class::*)(Args...)> {};
+template<typename Class, typename RetType, typename... Args>
+struct member_function_signature<RetType (Class::*)(Args...) & noexcept> : member_function_signature<RetType (Class::*)(Args...)> {};
+template<typename Class, typename RetType, typename... Args>
+struct member_function_signature<RetType (Class::*)(Args...) const & noexcept> : member_function_signature<RetType (Class::*)(Args...)> {};
+#endif
+
+/**
+ * Signature of callable types: function pointers and functors with a single non-template `operator()`.
+ * Generic and overloaded functors have no deducible signature, use `make` / `make_suffix` for them instead.
+ * @private
+ */
+template<typename Fn, typename Enable = void>
+struct callable_signature {};
+
+template<typename RetType, typename... Args>
+struct callable_signature<RetType (*)(Args...)> {
+	using type = RetType(Args...);
+};
+#if __cplusplus >= 201703L
+template<typename RetType, typename... Args>
+struct callable_signature<RetType (*)(Args...) noexcept> : callable_signature<RetType (*)(Args...)> {};
+#endif
+
+template<typename Fn>
+struct callable_signature<Fn, typename make_void<decltype(&Fn::operator())>::type> : member_function_signature<decltype(&Fn::operator())> {};
+
+/**
+ * Signature types deduced from `Fn`.
+ * @private
+ */
+template<typename Fn>
+using deduced_signature = signature<typename callable_signature<typename std::decay<Fn>::type>::type>;
+
+/**
+ * Wrapper type used to wrap `Fn`, with signature deduced from it.
+ * @private
+ */
+template<bool destroy_on_invoke, typename Fn>
+using deduced_function_wrapper = typename deduced_signature<Fn>::template wrapper<destroy_on_invoke, Fn>;
+
+/**
+ * Wrapper type used to wrap `Fn` allocating memory with `Alloc`, with signature deduced from it.
+ * @private
+ */
+template<bool destroy_on_invoke, typename Fn, typename Alloc>
+using deduced_allocated_function_wrapper = typename deduced_signature<Fn>::template allocated_wrapper<destroy_on_invoke, Fn, Alloc>;
+
+/**
+ * Reference counted wrapper type used to wrap `Fn`, with signature deduced from it.
+ * @private
+ */
+template<typename Policy, typename Fn>
+using deduced_refcounted_function_wrapper = typename deduced_signature<Fn>::template refcounted_wrapper<Policy, Fn>;
+
+/**
+ * Function reference type used to reference `Fn`, with signature deduced from it.
+ * @private
+ */
+template<typename Fn>
+using deduced_function_ref = typename deduced_signature<Fn>::template reference<Fn>;
+
+/**
+ * Asynchronous wrapper type used to wrap `Fn`, with signature deduced from it.
+ * @private
+ */
+template<typename Fn, typename Executor>
+using deduced_async_function = typename deduced_signature<Fn>::template async_wrapper<Fn, Executor>;
+
+/**
+ * Realtime wrapper type used to wrap `Fn`, with signature deduced from it.
+ * @private
+ */
+template<typename Fn>
+using deduced_realtime_function = typename deduced_signature<Fn>::template realtime_wrapper<Fn>;
+
+/**
+ * Contiguous wrapper type used to wrap many `Fn` elements of a range, with signature deduced from it.
+ * @private
+ */
+template<typename Range>
+using deduced_many_function = typename deduced_signature<decltype(*std::begin(std::declval<Range&>()))>::template many_wrapper<decltype(*std::begin(std::declval<Range&>()))>;
+
+}
+
+/**
+ * Transform `fn` into a [userdata, invoker, deleter] tuple.
+ *
+ * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ *
+ * @note You are responsible for calling the deleter with the userdata as parameter to reclaim allocated memory.
+ *
+ * @code
+ * auto [userdata, invoker, deleter] = prefix_invoker_deleter([](int value) {});
+ * // Invoke wrapped function as many times as you need.
+ * invoker(userdata, 1);
+ * invoker(userdata, 2);
+ * invoker(userdata, 3);
+ * // Delete wrapped function afterwards to avoid memory leak.
+ * deleter(userdata);
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata, plus its invoker and deleter functions.
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<void*, RetType (*)(void*, Args...), void (*)(void*)> prefix_invoker_deleter(Fn&& fn) {
+	return detail::function_wrapper_for<false, Fn, RetType, Args...>::prefix_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/**
+ * Transform `fn` into a [userdata, oneshot_invoker] tuple.
+ *
+ * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ * The allocated memory will be freed in the first invocation, so you must invoke it exactly once.
+ *
+ * @warning If you don't invoke the function, memory will leak.
+ * @warning If you try to invoke the function twice, your app will try to access freed memory and likely SEGFAULT.
+ *
+ * @code
+ * auto [userdata, oneshot_invoker] = prefix_invoker_oneshot([](int value) {});
+ * // Invoke wrapped function exactly once
+ * oneshot_invoker(userdata, 42);
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata, plus its oneshot invoker function.
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<void*, RetType (*)(void*, Args...)> prefix_invoker_oneshot(Fn&& fn) {
+	return detail::function_wrapper_for<true, Fn, RetType, Args...>::prefix_invoker(std::forward<Fn>(fn));
+}
+
+/**
+ * Transform `fn` into a [userdata, invoker] tuple.
+ *
+ * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ *
+ * @note The userdata is owned by a `std::unique_ptr`, so there's no need to manually delete it.
+ *
+ * @code
+ * auto [userdata, invoker] = prefix_invoker_unique([](int value) {});
+ * // Invoke wrapped function as many times as you need.
+ * invoker(userdata.get(), 1);
+ * invoker(userdata.get(), 2);
+ * invoker(userdata.get(), 3);
+ * // Userdata is a unique_ptr, memory will be freed automatically.
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata, plus its invoker and deleter functions.
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<std::unique_ptr<void, typename detail::function_wrapper_for<false, Fn, RetType, Args...>::deleter>, RetType (*)(void*, Args...)> prefix_invoker_unique(Fn&& fn) {
+	return detail::function_wrapper_for<false, Fn, RetType, Args...>::prefix_invoker_unique(std::forward<Fn>(fn));
+}
+
+/**
+ * Transform `fn` into a [userdata, invoker] tuple.
+ *
+ * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ *
+ * @note The userdata is retained by a `std::shared_ptr`, so there's no need to manually delete it.
+ *
+ * @code
+ * auto [userdata, invoker] = prefix_invoker_shared([](int value) {});
+ * // Invoke wrapped function as many times as you need.
+ * invoker(userdata.get(), 1);
+ * invoker(userdata.get(), 2);
+ * invoker(userdata.get(), 3);
+ * // Userdata is a shared_ptr, memory will be freed automatically.
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata, plus its invoker and deleter functions.
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<std::shared_ptr<void>, RetType (*)(void*, Args...)> prefix_invoker_shared(Fn&& fn) {
+	return detail::function_wrapper_for<false, Fn, RetType, Args...>::prefix_invoker_shared(std::forward<Fn>(fn));
+}
+
+
+/**
+ * Same as `prefix_invoker_deleter` where the invoker accepts userdata parameter suffix instead of prefix.
+ *
+ * @code
+ * auto [invoker, userdata, deleter] = suffix_invoker_deleter([](int value) {});
+ * // Invoke wrapped function as many times as you need.
+ * invoker(1, userdata);
+ * invoker(2, userdata);
+ * invoker(3, userdata);
+ * // Delete wrapped function afterwards to avoid memory leak.
+ * deleter(userdata);
+ * @endcode
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<RetType (*)(Args..., void*), void*, void (*)(void*)> suffix_invoker_deleter(Fn&& fn) {
+	return detail::function_wrapper_for<false, Fn, RetType, Args...>::suffix_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/**
+ * Same as `prefix_invoker_oneshot` where the invoker accepts userdata parameter suffix instead of prefix.
+ *
+ * @code
+ * auto [userdata, oneshot_invoker] = suffix_invoker_oneshot([](int value) {});
+ * // Invoke wrapped function exactly once
+ * oneshot_invoker(42, userdata);
+ * @endcode
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<RetType (*)(Args..., void*), void*> suffix_invoker_oneshot(Fn&& fn) {
+	return detail::function_wrapper_for<true, Fn, RetType, Args...>::suffix_invoker(std::forward<Fn>(fn));
+}
+
+/**
+ * Same as `prefix_invoker_unique` where the invoker accepts userdata parameter suffix instead of prefix.
+ *
+ * @code
+ * auto [userdata, invoker] = suffix_invoker_unique([](int value) {});
+ * // Invoke wrapped function as many times as you need.
+ * invoker(1, userdata.get());
+ * invoker(2, userdata.get());
+ * invoker(3, userdata.get());
+ * // Userdata is a unique_ptr, memory will be freed automatically.
+ * @endcode
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<std::unique_ptr<void, typename detail::function_wrapper_for<false, Fn, RetType, Args...>::deleter>, RetType (*)(Args..., void*)> suffix_invoker_unique(Fn&& fn) {
+	return detail::function_wrapper_for<false, Fn, RetType, Args...>::suffix_invoker_unique(std::forward<Fn>(fn));
+}
+
+/**
+ * Same as `prefix_invoker_shared` where the invoker accepts userdata parameter suffix instead of prefix.
+ *
+ * @code
+ * auto [userdata, invoker] = suffix_invoker_shared([](int value) {});
+ * // Invoke wrapped function as many times as you need.
+ * invoker(1, userdata.get());
+ * invoker(2, userdata.get());
+ * invoker(3, userdata.get());
+ * // Userdata is a shared_ptr, memory will be freed automatically.
+ * @endcode
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<std::shared_ptr<void>, RetType (*)(Args..., void*)> suffix_invoker_shared(Fn&& fn) {
+	return detail::function_wrapper_for<false, Fn, RetType, Args...>::suffix_invoker_shared(std::forward<Fn>(fn));
+}
+
+
+/**
+ * Same as `prefix_invoker_deleter`, but memory is allocated using `alloc`.
+ *
+ * `alloc` may be any allocator or a `std::pmr::memory_resource` pointer.
+ * The allocator is stored alongside the functor, so that the deleter gives memory back to it.
+ * Functors that require no allocation at all ignore `alloc`.
+ *
+ * @code
+ * std::pmr::monotonic_buffer_resource resource;
+ * auto [userdata, invoker, deleter] = prefix_invoker_deleter(std::allocator_arg, &resource, [](int value) {});
+ * invoker(userdata, 42);
+ * // Memory is given back to `resource`
+ * deleter(userdata);
+ * @endcode
+ */
+template<typename RetType, typename... Args, typename Alloc, typename Fn>
+std::tuple<void*, RetType (*)(void*, Args...), void (*)(void*)> prefix_invoker_deleter(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) {
+	return detail::allocated_function_wrapper_for<false, Fn, Alloc, RetType, Args...>::prefix_invoker_deleter(std::forward<Fn>(fn), alloc);
+}
+
+/// Same as `prefix_invoker_oneshot`, but memory is allocated using `alloc`.
+template<typename RetType, typename... Args, typename Alloc, typename Fn>
+std::tuple<void*, RetType (*)(void*, Args...)> prefix_invoker_oneshot(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) {
+	return detail::allocated_function_wrapper_for<true, Fn, Alloc, RetType, Args...>::prefix_invoker(std::forward<Fn>(fn), alloc);
+}
+
+/// Same as `prefix_invoker_unique`, but memory is allocated using `alloc`.
+template<typename RetType, typename... Args, typename Alloc, typename Fn>
+std::tuple<std::unique_ptr<void, typename detail::allocated_function_wrapper_for<false, Fn, Alloc, RetType, Args...>::deleter>, RetType (*)(void*, Args...)> prefix_invoker_unique(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) {
+	return detail::allocated_function_wrapper_for<false, Fn, Alloc, RetType, Args...>::prefix_invoker_unique(std::forward<Fn>(fn), alloc);
+}
+
+/// Same as `prefix_invoker_shared`, but memory is allocated using `alloc`, including the `std::shared_ptr` control block.
+template<typename RetType, typename... Args, typename Alloc, typename Fn>
+std::tuple<std::shared_ptr<void>, RetType (*)(void*, Args...)> prefix_invoker_shared(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) {
+	return detail::allocated_function_wrapper_for<false, Fn, Alloc, RetType, Args...>::prefix_invoker_shared(std::forward<Fn>(fn), alloc);
+}
+
+/// Same as `suffix_invoker_deleter`, but memory is allocated using `alloc`.
+template<typename RetType, typename... Args, typename Alloc, typename Fn>
+std::tuple<RetType (*)(Args..., void*), void*, void (*)(void*)> suffix_invoker_deleter(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) {
+	return detail::allocated_function_wrapper_for<false, Fn, Alloc, RetType, Args...>::suffix_invoker_deleter(std::forward<Fn>(fn), alloc);
+}
+
+/// Same as `suffix_invoker_oneshot`, but memory is allocated using `alloc`.
+template<typename RetType, typename... Args, typename Alloc, typename Fn>
+std::tuple<RetType (*)(Args..., void*), void*> suffix_invoker_oneshot(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) {
+	return detail::allocated_function_wrapper_for<true, Fn, Alloc, RetType, Args...>::suffix_invoker(std::forward<Fn>(fn), alloc);
+}
+
+/// Same as `suffix_invoker_unique`, but memory is allocated using `alloc`.
+template<typename RetType, typename... Args, typename Alloc, typename Fn>
+std::tuple<RetType (*)(Args..., void*), std::unique_ptr<void, typename detail::allocated_function_wrapper_for<false, Fn, Alloc, RetType, Args...>::deleter>> suffix_invoker_unique(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) {
+	return detail::allocated_function_wrapper_for<false, Fn, Alloc, RetType, Args...>::suffix_invoker_unique(std::forward<Fn>(fn), alloc);
+}
+
+/// Same as `suffix_invoker_shared`, but memory is allocated using `alloc`, including the `std::shared_ptr` control block.
+template<typename RetType, typename... Args, typename Alloc, typename Fn>
+std::tuple<RetType (*)(Args..., void*), std::shared_ptr<void>> suffix_invoker_shared(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) {
+	return detail::allocated_function_wrapper_for<false, Fn, Alloc, RetType, Args...>::suffix_invoker_shared(std::forward<Fn>(fn), alloc);
+}
+
+/**
+ * Statistics for the calling thread's `pool_allocator` cache.
+ */
+struct pool_stats {
+	/// Number of blocks allocated from the pool.
+	std::size_t allocations;
+	/// Number of allocations served by recycled blocks, without calling global `operator new`.
+	std::size_t hits;
+	/// Number of blocks freed by other threads and returned to this thread.
+	std::size_t remote_frees;
+
+	/// Ratio of allocations served by recycled blocks.
+	double hit_rate() const {
+		return allocations ? static_cast<double>(hits) / static_cast<double>(allocations) : 0.0;
+	}
+};
+
+namespace detail {
+
+/**
+ * Per-thread cache of freed blocks, split in power of two size classes.
+ *
+ * Blocks remember their owner cache. Blocks freed by other threads are pushed to the owner's
+ * lock-free remote list and moved back to its freelists on the owner's next allocation miss.
+ * Caches are reference counted by their outstanding blocks, so they outlive their thread
+ * until every block was returned.
+ * @private
+ */
+class pool_cache {
+public:
+	static constexpr std::size_t size_class_count = 6;
+	static constexpr std::size_t min_block_size = 16;
+	static constexpr std::size_t max_block_size = min_block_size << (size_class_count - 1);
+
+	struct block {
+		pool_cache *owner;
+		std::size_t size_class;
+		block *next;
+	};
+
+	static constexpr std::size_t payload_alignment = alignof(std::max_align_t);
+	static constexpr std::size_t payload_offset = (sizeof(block) + payload_alignment - 1) / payload_alignment * payload_alignment;
+
+	static void *allocate(std::size_t size) {
+		std::size_t size_class = 0;
+		while ((min_block_size << size_class) < size) {
+			size_class++;
+		}
+
+		pool_cache *cache = current();
+		block *b = cache ? cache->pop(size_class) : nullptr;
+		if (!b) {
+			b = static_cast<block*>(::operator new(payload_offset + (min_block_size << size_class)));
+			b->owner = cache;
+			b->size_class = size_class;
+		}
+		return reinterpret_cast<char*>(b) + payload_offset;
+	}
+
+	static void deallocate(void *pointer) {
+		block *b = reinterpret_cast<block*>(static_cast<char*>(pointer) - payload_offset);
+		pool_cache *owner = b->owner;
+		if (!owner) {
+			::operator delete(b);
+		}
+		else if (owner == current()) {
+			owner->push_local(b);
+			owner->references.fetch_sub(1, std::memory_order_relaxed);
+		}
+		else {
+			owner->push_remote(b);
+			owner->release();
+		}
+	}
+
+	static pool_stats thread_stats() {
+		pool_cache *cache = current();
+		return cache ? cache->stats : pool_stats {};
+	}
+
+private:
+	pool_cache() : free_lists(), stats(), remote_free(nullptr), references(1) {}
+
+	~pool_cache() {
+		for (block *&list : free_lists) {
+			delete_list(list);
+		}
+		delete_list(remote_free.exchange(nullptr, std::memory_order_acquire));
+	}
+
+	block *pop(std::size_t size_class) {
+		block *b = free_lists[size_class];
+		if (!b) {
+			collect_remote();
+			b = free_lists[size_class];
+		}
+		stats.allocations++;
+		references.fetch_add(1, std::memory_order_relaxed);
+		if (b) {
+			free_lists[size_class] = b->next;
+			stats.hits++;
+		}
+		return b;
+	}
+
+	void push_local(block *b) {
+		b->next = free_lists[b->size_class];
+		free_lists[b->size_class] = b;
+	}
+
+	void push_remote(block *b) {
+		b->next = remote_free.load(std::memory_order_relaxed);
+		while (!remote_free.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed)) {}
+	}
+
+	void collect_remote() {
+		block *b = remote_free.exchange(nullptr, std::memory_order_acquire);
+		while (b) {
+			block *next = b->next;
+			push_local(b);
+			stats.remote_frees++;
+			b = next;
+		}
+	}
+
+	void release() {
+		if (references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			delete this;
+		}
+	}
+
+	static void delete_list(block *b) {
+		while (b) {
+			block *next = b->next;
+			::operator delete(b);
+			b = next;
+		}
+	}
+
+	/// Releases the thread reference to its cache on thread exit.
+	struct thread_exit_guard {
+		~thread_exit_guard() {
+			pool_cache *cache = current_slot();
+			current_slot() = nullptr;
+			exited_slot() = true;
+			for (block *&list : cache->free_lists) {
+				delete_list(list);
+				list = nullptr;
+			}
+			cache->release();
+		}
+	};
+
+	static pool_cache *&current_slot() {
+		static thread_local pool_cache *cache = nullptr;
+		return cache;
+	}
+
+	static bool &exited_slot() {
+		static thread_local bool exited = false;
+		return exited;
+	}
+
+	static pool_cache *current() {
+		pool_cache *&cache = current_slot();
+		if (!cache && !exited_slot()) {
+			cache = new pool_cache;
+			static thread_local thread_exit_guard guard;
+		}
+		return cache;
+	}
+
+	block *free_lists[size_class_count];
+	pool_stats stats;
+	std::atomic<block*> remote_free;
+	std::atomic<std::size_t> references;
+};
+
+}
+
+/**
+ * Allocator that recycles memory blocks in thread-local freelists.
+ *
+ * Meant for wrappers that are created and destroyed at high rates, like oneshot invokers used as async completion callbacks.
+ * Blocks freed by other threads are returned to the thread that allocated them without locking.
+ * Allocations bigger than `detail::pool_cache::max_block_size` bytes or over-aligned types use global `operator new` directly.
+ *
+ * @code
+ * auto [userdata, oneshot_invoker] = prefix_invoker_oneshot(std::allocator_arg, functor2c::pool_allocator<char>(), [=](int result) {});
+ * // Memory is recycled by the pool on invocation
+ * oneshot_invoker(userdata, 42);
+ * double hit_rate = functor2c::pool_allocator<char>::thread_stats().hit_rate();
+ * @endcode
+ */
+template<typename T>
+struct pool_allocator {
+	using value_type = T;
+
+	pool_allocator() = default;
+	template<typename U>
+	pool_allocator(const pool_allocator<U>&) {}
+
+	T *allocate(std::size_t n) {
+		if (is_pooled(n)) {
+			return static_cast<T*>(detail::pool_cache::allocate(n * sizeof(T)));
+		}
+		else {
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+	}
+
+	void deallocate(T *pointer, std::size_t n) {
+		if (is_pooled(n)) {
+			detail::pool_cache::deallocate(pointer);
+		}
+		else {
+			::operator delete(pointer);
+		}
+	}
+
+	/// Statistics for the calling thread's pool cache.
+	static pool_stats thread_stats() {
+		return detail::pool_cache::thread_stats();
+	}
+
+private:
+	static bool is_pooled(std::size_t n) {
+		return n <= detail::pool_cache::max_block_size / sizeof(T)
+			&& alignof(T) <= detail::pool_cache::payload_alignment;
+	}
+};
+
+template<typename T, typename U>
+bool operator==(const pool_allocator<T>&, const pool_allocator<U>&) {
+	return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const pool_allocator<T>&, const pool_allocator<U>&) {
+	return false;
+}
+
+/// Reference counting policy using atomic operations, so that references may be retained/released from any thread.
+struct atomic_refcount {
+	using counter_type = std::atomic<std::size_t>;
+
+	static void increment(counter_type& count) {
+		count.fetch_add(1, std::memory_order_relaxed);
+	}
+	static bool decrement(counter_type& count) {
+		return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+	}
+};
+
+/// Reference counting policy using plain integers, for wrappers that are only retained/released from a single thread.
+struct nonatomic_refcount {
+	using counter_type = std::size_t;
+
+	static void increment(counter_type& count) {
+		++count;
+	}
+	static bool decrement(counter_type& count) {
+		return --count == 0;
+	}
+};
+
+/**
+ * Transform `fn` into a [userdata, invoker, retain, release] tuple, using an intrusive reference count.
+ *
+ * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ * The reference count lives in the same allocation as the functor and starts at 1.
+ * `retain` and `release` are C function pointers, suitable for C APIs that expect ref/unref callbacks like GLib.
+ * Memory is freed when `release` drops the last reference.
+ *
+ * `Policy` chooses between `atomic_refcount` and `nonatomic_refcount` counting.
+ *
+ * @code
+ * auto [userdata, invoker, retain, release] = prefix_invoker_refcounted(functor2c::atomic_refcount(), [](int value) {});
+ * retain(userdata);
+ * invoker(userdata, 42);
+ * release(userdata);
+ * // Memory is freed when the last reference is released
+ * release(userdata);
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata, plus its invoker, retain and release functions.
+ */
+template<typename RetType, typename... Args, typename Policy, typename Fn>
+std::tuple<void*, RetType (*)(void*, Args...), void (*)(void*), void (*)(void*)> prefix_invoker_refcounted(Policy, Fn&& fn) {
+	return detail::refcounted_function_wrapper_for<Policy, Fn, RetType, Args...>::prefix_invoker_refcounted(std::forward<Fn>(fn));
+}
+
+/// Same as `prefix_invoker_refcounted` using `atomic_refcount` policy.
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<void*, RetType (*)(void*, Args...), void (*)(void*), void (*)(void*)> prefix_invoker_refcounted(Fn&& fn) {
+	return detail::refcounted_function_wrapper_for<atomic_refcount, Fn, RetType, Args...>::prefix_invoker_refcounted(std::forward<Fn>(fn));
+}
+
+/**
+ * Same as `prefix_invoker_refcounted` where the invoker accepts userdata parameter suffix instead of prefix.
+ *
+ * @code
+ * auto [invoker, userdata, retain, release] = suffix_invoker_refcounted(functor2c::nonatomic_refcount(), [](int value) {});
+ * invoker(42, userdata);
+ * release(userdata);
+ * @endcode
+ */
+template<typename RetType, typename... Args, typename Policy, typename Fn>
+std::tuple<RetType (*)(Args..., void*), void*, void (*)(void*), void (*)(void*)> suffix_invoker_refcounted(Policy, Fn&& fn) {
+	return detail::refcounted_function_wrapper_for<Policy, Fn, RetType, Args...>::suffix_invoker_refcounted(std::forward<Fn>(fn));
+}
+
+/// Same as `suffix_invoker_refcounted` using `atomic_refcount` policy.
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<RetType (*)(Args..., void*), void*, void (*)(void*), void (*)(void*)> suffix_invoker_refcounted(Fn&& fn) {
+	return detail::refcounted_function_wrapper_for<atomic_refcount, Fn, RetType, Args...>::suffix_invoker_refcounted(std::forward<Fn>(fn));
+}
+
+/**
+ * Transform `fn` into a [userdata, vtable] tuple.
+ *
+ * The vtable is a pointer to a single static `function_vtable` per functor type, containing invoker, deleter and clone functions.
+ * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ * Clone is useful for C APIs that duplicate their context, copying the functor directly with its concrete type.
+ *
+ * @note You are responsible for calling `vtable->destroy` with the userdata as parameter to reclaim allocated memory.
+ *
+ * @code
+ * auto [userdata, vtable] = prefix_invoker_vtable([](int value) {});
+ * vtable->invoke(userdata, 42);
+ * void *copy = vtable->clone(userdata);
+ * vtable->invoke(copy, 42);
+ * vtable->destroy(copy);
+ * vtable->destroy(userdata);
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata, plus its static vtable.
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<void*, const function_vtable<RetType (*)(void*, Args...)>*> prefix_invoker_vtable(Fn&& fn) {
+	return detail::function_wrapper_for<false, Fn, RetType, Args...>::prefix_invoker_vtable(std::forward<Fn>(fn));
+}
+
+/**
+ * Same as `prefix_invoker_vtable` where the invoker accepts userdata parameter suffix instead of prefix.
+ *
+ * @code
+ * auto [vtable, userdata] = suffix_invoker_vtable([](int value) {});
+ * vtable->invoke(42, userdata);
+ * vtable->destroy(userdata);
+ * @endcode
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<const function_vtable<RetType (*)(Args..., void*)>*, void*> suffix_invoker_vtable(Fn&& fn) {
+	return detail::function_wrapper_for<false, Fn, RetType, Args...>::suffix_invoker_vtable(std::forward<Fn>(fn));
+}
+
+/**
+ * Transform `fn` into a [userdata, invoker, batch_invoker, deleter] tuple.
+ *
+ * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ * The batch invoker accepts the userdata, one array per parameter of `fn`, the number of elements `n`,
+ * plus an `out` array with `n` elements if `fn` returns a value.
+ * It calls `fn` once per element, turning N indirect calls into a single one, in a loop that the compiler can vectorize.
+ * The batch invoker returns `void`, since results are stored in `out`.
+ *
+ * @note You are responsible for calling the deleter with the userdata as parameter to reclaim allocated memory.
+ *
+ * @code
+ * auto [userdata, invoker, batch_invoker, deleter] = functor2c::prefix_invoker_batch([gain](float sample, float envelope) {
+ *     return sample * envelope * gain;
+ * });
+ * batch_invoker(userdata, samples, envelopes, frame_count, output);
+ * deleter(userdata);
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata, plus its invoker, batch invoker and deleter functions.
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<void*, RetType (*)(void*, Args...), typename detail::batch_signature<RetType, Args...>::prefix_pointer, void (*)(void*)> prefix_invoker_batch(Fn&& fn) {
+	return detail::function_wrapper_for<false, Fn, RetType, Args...>::prefix_invoker_batch(std::forward<Fn>(fn));
+}
+
+/**
+ * Same as `prefix_invoker_batch` where the invoker and batch invoker accept userdata parameter suffix instead of prefix.
+ *
+ * @return Tuple containing the invoker, an opaque userdata, plus its batch invoker and deleter functions.
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<RetType (*)(Args..., void*), void*, typename detail::batch_signature<RetType, Args...>::suffix_pointer, void (*)(void*)> suffix_invoker_batch(Fn&& fn) {
+	return detail::function_wrapper_for<false, Fn, RetType, Args...>::suffix_invoker_batch(std::forward<Fn>(fn));
+}
+
+/**
+ * Policy tag for invokers called from realtime threads, like audio or control loop callbacks.
+ *
+ * Realtime invokers check at compile time that `fn` is `noexcept` and not a `std::function`.
+ * Oneshot invokers are not available, since they would deallocate memory in the calling thread.
+ *
+ * For verifying that nothing allocates inside realtime invokers, define `FUNCTOR2C_REALTIME_ALLOCATION_TRAP`
+ * when compiling every source file, then define `FUNCTOR2C_REALTIME_ALLOCATION_TRAP_IMPLEMENTATION` in exactly one of them
+ * before including `functor2c.hpp`. This replaces the global `operator new` and `operator delete` with versions that call
+ * `FUNCTOR2C_REALTIME_TRAP()`, which defaults to `std::abort()`, when used inside a realtime invoker.
+ *
+ * @code
+ * auto [userdata, invoker, deleter] = functor2c::prefix_invoker_deleter(functor2c::realtime(), [&](const float *input, float *output, unsigned long frames) noexcept {
+ *     // process audio
+ * });
+ * @endcode
+ */
+struct realtime {};
+
+/// Whether the current thread is running a realtime invoker. Always false unless `FUNCTOR2C_REALTIME_ALLOCATION_TRAP` is defined.
+inline bool in_realtime_invoker() noexcept {
+#ifdef FUNCTOR2C_REALTIME_ALLOCATION_TRAP
+	return detail::realtime_scope::depth() > 0;
+#else
+	return false;
+#endif
+}
+
+/// Same as `prefix_invoker_deleter`, checking that `fn` is safe for realtime threads.
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<void*, RetType (*)(void*, Args...), void (*)(void*)> prefix_invoker_deleter(realtime, Fn&& fn) {
+	return detail::realtime_function<typename std::decay<Fn>::type, RetType, Args...>::prefix_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/// Same as `prefix_invoker_unique`, checking that `fn` is safe for realtime threads.
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<std::unique_ptr<void, typename detail::realtime_function<typename std::decay<Fn>::type, RetType, Args...>::deleter>, RetType (*)(void*, Args...)> prefix_invoker_unique(realtime, Fn&& fn) {
+	return detail::realtime_function<typename std::decay<Fn>::type, RetType, Args...>::prefix_invoker_unique(std::forward<Fn>(fn));
+}
+
+/// Same as `suffix_invoker_deleter`, checking that `fn` is safe for realtime threads.
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<RetType (*)(Args..., void*), void*, void (*)(void*)> suffix_invoker_deleter(realtime, Fn&& fn) {
+	return detail::realtime_function<typename std::decay<Fn>::type, RetType, Args...>::suffix_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/// Same as `suffix_invoker_unique`, checking that `fn` is safe for realtime threads.
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<RetType (*)(Args..., void*), std::unique_ptr<void, typename detail::realtime_function<typename std::decay<Fn>::type, RetType, Args...>::deleter>> suffix_invoker_unique(realtime, Fn&& fn) {
+	return detail::realtime_function<typename std::decay<Fn>::type, RetType, Args...>::suffix_invoker_unique(std::forward<Fn>(fn));
+}
+
+/// Oneshot invokers deallocate memory in the calling thread, so they cannot be used in realtime threads.
+template<typename... Args, typename Fn>
+void prefix_invoker_oneshot(realtime, Fn&& fn) = delete;
+
+/// Oneshot invokers deallocate memory in the calling thread, so they cannot be used in realtime threads.
+template<typename... Args, typename Fn>
+void suffix_invoker_oneshot(realtime, Fn&& fn) = delete;
+
+/**
+ * Transform `fn` into a [userdata, invoker, deleter] tuple, with the invoker typed exactly as the C function `CFunction`.
+ *
+ * `CFunction` is a C function type, or pointer to one, that accepts a `void*` userdata as its first parameter.
+ * The remaining parameters and return type are used as the signature for `fn`,
+ * so generic lambdas and overloaded functors are also supported.
+ *
+ * @note You are responsible for calling the deleter with the userdata as parameter to reclaim allocated memory.
+ *
+ * @code
+ * auto [userdata, invoker, deleter] = make<lua_Alloc>([](void *ptr, size_t osize, size_t nsize) { ... });
+ * lua_setallocf(L, invoker, userdata);
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata, plus its invoker and deleter functions.
+ */
+template<typename CFunction, typename Fn>
+std::tuple<void*, typename detail::prefix_c_function<CFunction>::pointer, void (*)(void*)> make(Fn&& fn) {
+	return detail::prefix_c_function<CFunction>::template wrapper<false, Fn>::prefix_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/**
+ * Same as `make` where `CFunction` accepts a `void*` userdata as its last parameter.
+ *
+ * @code
+ * auto [invoker, userdata, deleter] = make_suffix<b2CustomFilterFcn*>([](auto shapeIdA, auto shapeIdB) { return true; });
+ * b2World_SetCustomFilterCallback(world_id, invoker, userdata);
+ * @endcode
+ */
+template<typename CFunction, typename Fn>
+std::tuple<typename detail::suffix_c_function<CFunction>::pointer, void*, void (*)(void*)> make_suffix(Fn&& fn) {
+	return detail::suffix_c_function<CFunction>::template wrapper<false, Fn>::suffix_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/**
+ * Transform every functor in `range` into a [userdatas, count, invoker, deleter] tuple, using a single allocation.
+ *
+ * Functors are stored contiguously, right after the array of their userdata, so creating and destroying them
+ * is a single allocation and iterating over them is cache friendly.
+ * Functors are copied from `range`, or moved if `range` is an rvalue.
+ * The invoker is shared by every functor, accepting the same parameters as them, with the addition of the `userdata` prefix argument.
+ * Elements of the userdata array keep the same order as `range`, with `count` being the number of elements.
+ * `range` must provide forward iterators, since it is traversed once for sizing the allocation and once for copying.
+ *
+ * @note You are responsible for calling the deleter with the userdata array as parameter to reclaim allocated memory,
+ *       which destroys every functor at once.
+ *
+ * @code
+ * std::vector<ColumnFormatter> formatters = ...;
+ * auto [userdatas, count, invoker, deleter] = functor2c::make_many(formatters);
+ * for (std::size_t i = 0; i < count; i++) {
+ *     set_column_formatter(table, i, invoker, userdatas[i]);
+ * }
+ * deleter(userdatas);
+ * @endcode
+ *
+ * @return Tuple containing the array of opaque userdata and its size, plus the shared invoker and the bulk deleter functions.
+ */
+template<typename RetType, typename... Args, typename Range>
+std::tuple<void**, std::size_t, RetType (*)(void*, Args...), void (*)(void*)> make_many(Range&& range) {
+	return detail::many_function<typename std::decay<decltype(*std::begin(range))>::type, RetType, Args...>::prefix_invoker(std::forward<Range>(range));
+}
+
+/**
+ * Same as `make_many` where the invoker accepts userdata parameter suffix instead of prefix.
+ */
+template<typename RetType, typename... Args, typename Range>
+std::tuple<RetType (*)(Args..., void*), void**, std::size_t, void (*)(void*)> make_many_suffix(Range&& range) {
+	return detail::many_function<typename std::decay<decltype(*std::begin(range))>::type, RetType, Args...>::suffix_invoker(std::forward<Range>(range));
+}
+
+/**
+ * View over a NUL-terminated C string, whose length is only computed when needed.
+ *
+ * Use it as a parameter of functors passed to `make_adapted` for `const char*` C arguments.
+ */
+class lazy_string_view {
+public:
+	lazy_string_view() = default;
+	explicit lazy_string_view(const char *str) : str(str) {}
+
+	/// Pointer to the NUL-terminated string, never null.
+	const char *data() const {
+		return str ? str : "";
+	}
+
+	/// Same as `data`.
+	const char *c_str() const {
+		return data();
+	}
+
+	/// Length of the string, computed on first use.
+	std::size_t size() const {
+		if (length == unknown_length) {
+			length = str ? std::strlen(str) : 0;
+		}
+		return length;
+	}
+
+	/// Whether the string is empty, without computing its length.
+	bool empty() const {
+		return !str || !*str;
+	}
+
+#ifdef FUNCTOR2C_HAS_STRING_VIEW
+	operator std::string_view() const {
+		return std::string_view(data(), size());
+	}
+#endif
+
+private:
+	static constexpr std::size_t unknown_length = ~std::size_t(0);
+
+	const char *str = nullptr;
+	mutable std::size_t length = unknown_length;
+};
+
+namespace detail {
+
+/**
+ * Adapter that passes a single C argument through, converting it implicitly to the functor parameter.
+ * @private
+ */
+struct pass_adapter {
+	static constexpr std::size_t arity = 1;
+
+	template<std::size_t Index, typename Tuple>
+	static typename std::tuple_element<Index, Tuple>::type get(Tuple& args) {
+		return std::forward<typename std::tuple_element<Index, Tuple>::type>(std::get<Index>(args));
+	}
+};
+
+/**
+ * Adapter from a pointer plus size pair of C arguments into a view functor parameter `Param`.
+ * @private
+ */
+template<typename Param, typename... Args>
+struct sized_view_adapter : std::false_type {};
+
+#ifdef FUNCTOR2C_HAS_STRING_VIEW
+template<typename Char, typename Size, typename... Rest>
+struct sized_view_adapter<std::string_view, Char*, Size, Rest...> : std::integral_constant<bool,
+	std::is_same<typename std::remove_const<Char>::type, char>::value && std::is_integral<Size>::value
+> {
+	static constexpr std::size_t arity = 2;
+
+	template<std::size_t Index, typename Tuple>
+	static std::string_view get(Tuple& args) {
+		return std::string_view(std::get<Index>(args), std::get<Index + 1>(args));
+	}
+};
+#endif
+
+#ifdef FUNCTOR2C_HAS_SPAN
+template<typename T, typename U, typename Size, typename... Rest>
+struct sized_view_adapter<std::span<T>, U*, Size, Rest...> : std::integral_constant<bool,
+	std::is_convertible<U(*)[], T(*)[]>::value && std::is_integral<Size>::value
+> {
+	static constexpr std::size_t arity = 2;
+
+	template<std::size_t Index, typename Tuple>
+	static std::span<T> get(Tuple& args) {
+		return std::span<T>(std::get<Index>(args), std::get<Index + 1>(args));
+	}
+};
+#endif
+
+/**
+ * Adapter from a NUL-terminated C string argument into a string view functor parameter `Param`.
+ * @private
+ */
+template<typename Param, typename... Args>
+struct c_string_adapter : std::false_type {};
+
+template<typename Char, typename... Rest>
+struct c_string_adapter<lazy_string_view, Char*, Rest...> : std::is_same<typename std::remove_const<Char>::type, char> {
+	static constexpr std::size_t arity = 1;
+
+	template<std::size_t Index, typename Tuple>
+	static lazy_string_view get(Tuple& args) {
+		return lazy_string_view(std::get<Index>(args));
+	}
+};
+
+#ifdef FUNCTOR2C_HAS_STRING_VIEW
+template<typename Char, typename... Rest>
+struct c_string_adapter<std::string_view, Char*, Rest...> : std::is_same<typename std::remove_const<Char>::type, char> {
+	static constexpr std::size_t arity = 1;
+
+	template<std::size_t Index, typename Tuple>
+	static std::string_view get(Tuple& args) {
+		const char *str = std::get<Index>(args);
+		return str ? std::string_view(str) : std::string_view();
+	}
+};
+#endif
+
+/**
+ * Whether the first C argument in `Args` may be passed through to functor parameter `Param`.
+ * @private
+ */
+template<typename Param, typename... Args>
+struct pass_adaptable : std::false_type {};
+
+template<typename Param, typename Arg, typename... Rest>
+struct pass_adaptable<Param, Arg, Rest...> : std::is_convertible<Arg, Param> {};
+
+/**
+ * Adapter used for one functor parameter, reading C arguments starting at `Index`.
+ * @private
+ */
+template<typename Adapter, std::size_t Index>
+struct adapter_step {
+	using adapter = Adapter;
+	static constexpr std::size_t index = Index;
+};
+
+/**
+ * Drop the first `Count` types from a type list.
+ * @private
+ */
+template<std::size_t Count, typename List, typename Enable = void>
+struct drop_types {
+	using type = List;
+};
+
+template<std::size_t Count, typename First, typename... Rest>
+struct drop_types<Count, type_list<First, Rest...>, typename std::enable_if<(Count > 0)>::type> : drop_types<Count - 1, type_list<Rest...>> {};
+
+/**
+ * List of `adapter_step` for every functor parameter in `Params`, consuming every C argument in `Args`.
+ * `value` tells whether such a list exists, in which case `type` is the list.
+ * Pointer plus size pairs are preferred over single C strings, which are preferred over passing arguments through,
+ * falling back to the next adapter whenever the preferred one leaves the remaining parameters unmatched.
+ * @private
+ */
+template<typename Params, typename Args, std::size_t Index = 0, typename Steps = type_list<>>
+struct adapter_plan : std::false_type {
+	using type = type_list<>;
+};
+
+template<std::size_t Index, typename... Steps>
+struct adapter_plan<type_list<>, type_list<>, Index, type_list<Steps...>> : std::true_type {
+	using type = type_list<Steps...>;
+};
+
+/**
+ * Plan for the remaining functor parameters `Params` after using `Adapter` for the first one, if `Applicable`.
+ * @private
+ */
+template<bool Applicable, typename Adapter, typename Params, typename Args, std::size_t Index, typename Steps>
+struct adapter_attempt : std::false_type {
+	using type = type_list<>;
+};
+
+template<typename Adapter, typename Params, typename... Args, std::size_t Index, typename... Steps>
+struct adapter_attempt<true, Adapter, Params, type_list<Args...>, Index, type_list<Steps...>> : adapter_plan<
+	Params,
+	typename drop_types<Adapter::arity, type_list<Args...>>::type,
+	Index + Adapter::arity,
+	type_list<Steps..., adapter_step<Adapter, Index>>
+> {};
+
+template<typename Param, typename... Params, typename... Args, std::size_t Index, typename Steps>
+struct adapter_plan<type_list<Param, Params...>, type_list<Args...>, Index, Steps> : std::conditional<
+	adapter_attempt<sized_view_adapter<typename std::decay<Param>::type, Args...>::value, sized_view_adapter<typename std::decay<Param>::type, Args...>, type_list<Params...>, type_list<Args...>, Index, Steps>::value,
+	adapter_attempt<sized_view_adapter<typename std::decay<Param>::type, Args...>::value, sized_view_adapter<typename std::decay<Param>::type, Args...>, type_list<Params...>, type_list<Args...>, Index, Steps>,
+	typename std::conditional<
+		adapter_attempt<c_string_adapter<typename std::decay<Param>::type, Args...>::value, c_string_adapter<typename std::decay<Param>::type, Args...>, type_list<Params...>, type_list<Args...>, Index, Steps>::value,
+		adapter_attempt<c_string_adapter<typename std::decay<Param>::type, Args...>::value, c_string_adapter<typename std::decay<Param>::type, Args...>, type_list<Params...>, type_list<Args...>, Index, Steps>,
+		adapter_attempt<pass_adaptable<Param, Args...>::value, pass_adapter, type_list<Params...>, type_list<Args...>, Index, Steps>
+	>::type
+>::type {};
+
+/**
+ * Convert functor results to the C return type, with enums converted to their underlying integer values.
+ * @private
+ */
+template<typename To, typename From>
+typename std::enable_if<std::is_enum<typename std::decay<From>::type>::value && !std::is_enum<To>::value, To>::type convert_result(From&& value) {
+	return static_cast<To>(value);
+}
+
+template<typename To, typename From>
+typename std::enable_if<!(std::is_enum<typename std::decay<From>::type>::value && !std::is_enum<To>::value), To>::type convert_result(From&& value) {
+	return std::forward<From>(value);
+}
+
+/**
+ * Parameters of the functor signature `Signature`.
+ * @private
+ */
+template<typename Signature>
+struct signature_parameters;
+
+template<typename FnRetType, typename... Params>
+struct signature_parameters<FnRetType(Params...)> {
+	using type = type_list<Params...>;
+
+	template<typename Fn>
+	using is_const_invocable = detail::is_const_invocable<Fn, Params...>;
+};
+
+/**
+ * Stateless functors are held as an empty base, so that adapting them still requires no allocation at all.
+ * @private
+ */
+template<typename Fn, typename RetType, typename... Args>
+struct adapted_function : private functor_holder<Fn> {
+	using parameters = signature_parameters<typename callable_signature<Fn>::type>;
+	static_assert(adapter_plan<typename parameters::type, type_list<Args...>>::value, "Functor parameters do not match the C function arguments");
+	using plan = typename adapter_plan<typename parameters::type, type_list<Args...>>::type;
+
+	explicit adapted_function(const Fn& fn) : functor_holder<Fn>(fn) {}
+	explicit adapted_function(Fn&& fn) : functor_holder<Fn>(std::move(fn)) {}
+
+	RetType operator()(Args&&... args) {
+		return invoke(this->get_functor(), std::is_void<RetType>(), plan(), std::forward_as_tuple(std::forward<Args>(args)...));
+	}
+
+	template<typename F = Fn, typename = typename std::enable_if<parameters::template is_const_invocable<F>::value>::type>
+	RetType operator()(Args&&... args) const {
+		return invoke(this->get_functor(), std::is_void<RetType>(), plan(), std::forward_as_tuple(std::forward<Args>(args)...));
+	}
+
+private:
+	template<typename F, typename... Steps, typename Tuple>
+	static RetType invoke(F& fn, std::true_type /* is_void */, type_list<Steps...>, Tuple&& args) {
+		fn(Steps::adapter::template get<Steps::index>(args)...);
+	}
+
+	template<typename F, typename... Steps, typename Tuple>
+	static RetType invoke(F& fn, std::false_type /* is_void */, type_list<Steps...>, Tuple&& args) {
+		return convert_result<RetType>(fn(Steps::adapter::template get<Steps::index>(args)...));
+	}
+};
+
+}
+
+/**
+ * Same as `make`, adapting C arguments to the parameter types of `fn` without copying buffers.
+ *
+ * The adaptation is resolved at compile time from the parameters of `fn`, so generic and overloaded functors are not supported:
+ * - `(const char*, size_t)` arguments are passed as a single `std::string_view` parameter (C++17)
+ * - `(T*, size_t)` arguments are passed as a single `std::span<T>` parameter (C++20)
+ * - `const char*` NUL-terminated strings are passed as `lazy_string_view` or `std::string_view` parameters
+ * - Other arguments are passed through, converting implicitly to the parameter types
+ *
+ * Results of `fn` are converted to the C return type, with enums converted to their underlying integer values.
+ *
+ * @code
+ * // void on_message(void *userdata, const char *topic, const char *payload, size_t payload_size);
+ * auto [userdata, invoker, deleter] = functor2c::make_adapted<decltype(on_message)>([](functor2c::lazy_string_view topic, std::string_view payload) {
+ *     // ...
+ * });
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata, plus its invoker and deleter functions.
+ */
+template<typename CFunction, typename Fn>
+std::tuple<void*, typename detail::prefix_c_function<CFunction>::pointer, void (*)(void*)> make_adapted(Fn&& fn) {
+	return detail::prefix_c_function<CFunction>::adapted_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/**
+ * Same as `make_adapted` where `CFunction` accepts a `void*` userdata as its last parameter.
+ */
+template<typename CFunction, typename Fn>
+std::tuple<typename detail::suffix_c_function<CFunction>::pointer, void*, void (*)(void*)> make_adapted_suffix(Fn&& fn) {
+	return detail::suffix_c_function<CFunction>::adapted_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/**
+ * Reference `fn` as a [userdata, invoker] tuple, without allocating or copying anything.
+ *
+ * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ * The userdata is the address of `fn` itself, so this is best suited for C APIs that only use callbacks
+ * for the duration of a call, like `qsort_r` or foreach-style iterators.
+ *
+ * @warning `fn` must outlive any invocations.
+ *
+ * @code
+ * auto compare = [&](const void *a, const void *b) { return ...; };
+ * auto [userdata, invoker] = prefix_invoker_ref<int, const void*, const void*>(compare);
+ * qsort_r(array, count, size, userdata, invoker);  // BSD qsort_r
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata pointing to `fn`, plus its invoker function.
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<void*, RetType (*)(void*, Args...)> prefix_invoker_ref(Fn& fn) {
+	return detail::function_ref<Fn, RetType, Args...>::prefix_invoker(fn);
+}
+
+/**
+ * Same as `prefix_invoker_ref` where the invoker accepts userdata parameter suffix instead of prefix.
+ *
+ * @code
+ * auto compare = [&](const void *a, const void *b) { return ...; };
+ * auto [invoker, userdata] = suffix_invoker_ref<int, const void*, const void*>(compare);
+ * qsort_r(array, count, size, invoker, userdata);  // GNU qsort_r
+ * @endcode
+ */
+template<typename RetType, typename... Args, typename Fn>
+std::tuple<RetType (*)(Args..., void*), void*> suffix_invoker_ref(Fn& fn) {
+	return detail::function_ref<Fn, RetType, Args...>::suffix_invoker(fn);
+}
+
+/**
+ * Storage for wrapping a functor in place, inside memory owned by the caller.
+ *
+ * Use it as a member of objects that own C callbacks, or in a stack buffer,
+ * so that the functor shares their allocation instead of living in a separate heap block.
+ * The stored functor is destroyed when the `inline_invoker` is destroyed or reset.
+ * Trying to store a functor that does not fit in `Capacity` bytes with `Align` alignment is a compile-time error.
+ *
+ * @code
+ * struct Connection {
+ *     functor2c::inline_invoker<void(int), 32> on_event;
+ * };
+ * auto [userdata, invoker] = connection.on_event.prefix_invoker([this](int event) {});
+ * invoker(userdata, 42);
+ * @endcode
+ */
+template<typename Signature, std::size_t Capacity, std::size_t Align = alignof(std::max_align_t)>
+class inline_invoker;
+
+template<typename RetType, typename... Args, std::size_t Capacity, std::size_t Align>
+class inline_invoker<RetType(Args...), Capacity, Align> {
+public:
+	inline_invoker() = default;
+	inline_invoker(const inline_invoker&) = delete;
+	inline_invoker& operator=(const inline_invoker&) = delete;
+	~inline_invoker() {
+		reset();
+	}
+
+	/**
+	 * Store `fn` in place, destroying any previously stored functor, and return a [userdata, invoker] tuple.
+	 *
+	 * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+	 * The userdata points inside this object, so it is valid until this object is destroyed or reset.
+	 */
+	template<typename Fn>
+	std::tuple<void*, RetType (*)(void*, Args...)> prefix_invoker(Fn&& fn) {
+		return std::make_tuple(emplace(std::forward<Fn>(fn)), detail::function_ref<typename std::decay<Fn>::type, RetType, Args...>::invoke_prefix);
+	}
+
+	/**
+	 * Same as `prefix_invoker` where the invoker accepts userdata parameter suffix instead of prefix.
+	 */
+	template<typename Fn>
+	std::tuple<RetType (*)(Args..., void*), void*> suffix_invoker(Fn&& fn) {
+		return std::make_tuple(detail::function_ref<typename std::decay<Fn>::type, RetType, Args...>::invoke_suffix, emplace(std::forward<Fn>(fn)));
+	}
+
+	/// Destroy the stored functor, if any.
+	void reset() {
+		if (destroy) {
+			destroy(&storage);
+			destroy = nullptr;
+		}
+	}
+
+	/// Whether a functor is currently stored.
+	explicit operator bool() const {
+		return destroy != nullptr;
+	}
+
+private:
+	template<typename Fn>
+	void *emplace(Fn&& fn) {
+		using F = typename std::decay<Fn>::type;
+		static_assert(sizeof(F) <= Capacity, "Functor does not fit in inline_invoker capacity");
+		static_assert(alignof(F) <= Align, "Functor alignment is bigger than inline_invoker alignment");
+		reset();
+		void *userdata = new (&storage) F(std::forward<Fn>(fn));
+		destroy = destroy_functor<F>;
+		return userdata;
+	}
+
+	template<typename F>
+	static void destroy_functor(void *userdata) {
+		static_cast<F*>(userdata)->~F();
+	}
+
+	alignas(Align) unsigned char storage[Capacity];
+	void (*destroy)(void*) = nullptr;
+};
+
+/**
+ * Bump allocator for bulk-created wrappers that are all released at once.
+ *
+ * Functors are stored contiguously in chunks of memory owned by the arena, so creating wrappers is just a pointer bump
+ * and there are no individual deleters. `reset` runs the destructors of non-trivially destructible functors
+ * and reclaims all memory at once, keeping chunks around for reuse.
+ *
+ * @note Arenas are not thread-safe.
+ *
+ * @code
+ * functor2c::arena frame_arena;
+ * for (auto& body : bodies) {
+ *     auto [userdata, invoker] = frame_arena.prefix_invoker([&body](int contact) {});
+ *     register_callback(invoker, userdata);
+ * }
+ * // At the end of the frame, release every wrapper at once
+ * frame_arena.reset();
+ * @endcode
+ */
+class arena {
+public:
+	/// Create an empty arena that allocates memory in chunks of at least `chunk_size` bytes.
+	explicit arena(std::size_t chunk_size = 4096) : chunk_size(chunk_size) {}
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+
+	~arena() {
+		reset();
+		while (first) {
+			chunk *next = first->next;
+			::operator delete(first);
+			first = next;
+		}
+	}
+
+	/**
+	 * Store `fn` in the arena and return a [userdata, invoker] tuple.
+	 *
+	 * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+	 * The userdata is valid until the arena is reset or destroyed.
+	 */
+	template<typename RetType, typename... Args, typename Fn>
+	std::tuple<void*, RetType (*)(void*, Args...)> prefix_invoker(Fn&& fn) {
+		return std::make_tuple(emplace(std::forward<Fn>(fn)), detail::function_ref<typename std::decay<Fn>::type, RetType, Args...>::invoke_prefix);
+	}
+
+	/**
+	 * Same as `prefix_invoker` where the invoker accepts userdata parameter suffix instead of prefix.
+	 */
+	template<typename RetType, typename... Args, typename Fn>
+	std::tuple<RetType (*)(Args..., void*), void*> suffix_invoker(Fn&& fn) {
+		return std::make_tuple(detail::function_ref<typename std::decay<Fn>::type, RetType, Args...>::invoke_suffix, emplace(std::forward<Fn>(fn)));
+	}
+
+	/// Overload used for automatic type deduction
+	template<typename Fn>
+	auto prefix_invoker(Fn&& fn) -> std::tuple<void*, decltype(&detail::deduced_function_ref<typename std::decay<Fn>::type>::invoke_prefix)> {
+		return std::make_tuple(emplace(std::forward<Fn>(fn)), detail::deduced_function_ref<typename std::decay<Fn>::type>::invoke_prefix);
+	}
+
+	/// Overload used for automatic type deduction
+	template<typename Fn>
+	auto suffix_invoker(Fn&& fn) -> std::tuple<decltype(&detail::deduced_function_ref<typename std::decay<Fn>::type>::invoke_suffix), void*> {
+		return std::make_tuple(detail::deduced_function_ref<typename std::decay<Fn>::type>::invoke_suffix, emplace(std::forward<Fn>(fn)));
+	}
+
+	/**
+	 * Destroy every functor stored in the arena, in reverse order of creation, and reclaim all memory at once.
+	 *
+	 * Memory chunks are kept for reuse by following allocations.
+	 */
+	void reset() {
+		while (destructors) {
+			destructors->destroy(destructors->object);
+			destructors = destructors->next;
+		}
+		current = first;
+		offset = sizeof(chunk);
+	}
+
+private:
+	struct chunk {
+		chunk *next;
+		std::size_t size;
+	};
+
+	struct destructor {
+		void (*destroy)(void*);
+		void *object;
+		destructor *next;
+	};
+
+	template<typename Fn>
+	void *emplace(Fn&& fn) {
+		using F = typename std::decay<Fn>::type;
+		static_assert(alignof(F) <= alignof(std::max_align_t), "Over-aligned functors are not supported by arena");
+		destructor *node = std::is_trivially_destructible<F>::value
+			? nullptr
+			: static_cast<destructor*>(allocate(sizeof(destructor), alignof(destructor)));
+		F *object = new (allocate(sizeof(F), alignof(F))) F(std::forward<Fn>(fn));
+		if (node) {
+			destructors = new (node) destructor { destroy_functor<F>, object, destructors };
+		}
+		return object;
+	}
+
+	template<typename F>
+	static void destroy_functor(void *object) {
+		static_cast<F*>(object)->~F();
+	}
+
+	void *allocate(std::size_t size, std::size_t alignment) {
+		while (current) {
+			std::size_t aligned_offset = (offset + alignment - 1) / alignment * alignment;
+			if (aligned_offset + size <= current->size) {
+				offset = aligned_offset + size;
+				return reinterpret_cast<char*>(current) + aligned_offset;
+			}
+			current = current->next;
+			offset = sizeof(chunk);
+		}
+
+		std::size_t new_chunk_size = sizeof(chunk) + size + alignment;
+		if (new_chunk_size < chunk_size) {
+			new_chunk_size = chunk_size;
+		}
+		chunk *new_chunk = static_cast<chunk*>(::operator new(new_chunk_size));
+		new_chunk->next = nullptr;
+		new_chunk->size = new_chunk_size;
+		if (last) {
+			last->next = new_chunk;
+		}
+		else {
+			first = new_chunk;
+		}
+		last = current = new_chunk;
+		offset = sizeof(chunk);
+		return allocate(size, alignment);
+	}
+
+	std::size_t chunk_size;
+	chunk *first = nullptr;
+	chunk *last = nullptr;
+	chunk *current = nullptr;
+	std::size_t offset = 0;
+	destructor *destructors = nullptr;
+};
+
+/**
+ * Single C callback that dispatches to any number of subscribed handlers.
+ *
+ * Handlers are stored by value, contiguously in a single immutable buffer, so dispatching walks memory linearly.
+ * Subscribing and unsubscribing copy the handlers into a new buffer that replaces the current one (copy-on-write),
+ * so they may be called while other threads are dispatching, and even from inside handlers.
+ * Dispatching never takes a lock: each buffer counts the dispatches reading it, and replaced buffers are freed
+ * by later writers or by the destructor as soon as they are not being read, even if other dispatches never stop.
+ *
+ * Handlers receive arguments as lvalues, since the same arguments are passed to every handler.
+ * Rvalue reference parameters are passed on to every handler as rvalue references, so handlers must not move from them,
+ * or later handlers see moved-from values.
+ * For non-void return types, the result of the last handler is returned, or a value-initialized `RetType` if there are no handlers.
+ *
+ * @note Handlers must be copy constructible.
+ * @warning The userdata points to this object, so it must outlive every registered callback.
+ *
+ * @code
+ * functor2c::multicast<void(int)> on_event;
+ * auto id = on_event.subscribe([](int event) {});
+ * on_event.subscribe([this](int event) {});
+ * auto [userdata, invoker] = on_event.prefix_invoker();
+ * invoker(userdata, 42);
+ * on_event.unsubscribe(id);
+ * @endcode
+ */
+template<typename Signature>
+class multicast;
+
+template<typename RetType, typename... Args>
+class multicast<RetType(Args...)> {
+public:
+	/// Identifier returned by `subscribe`, used for unsubscribing handlers.
+	using subscription = std::size_t;
+
+	multicast() = default;
+	multicast(const multicast&) = delete;
+	multicast& operator=(const multicast&) = delete;
+	~multicast() {
+		delete_snapshots(current.load());
+		delete_snapshots(retired);
+		delete_snapshots(free_snapshots);
+	}
+
+	/**
+	 * Subscribe a copy of `fn` to be invoked on dispatch, after every handler already subscribed.
+	 * @return Identifier used to unsubscribe the handler.
+	 */
+	template<typename Fn>
+	subscription subscribe(Fn&& fn) {
+		using F = typename std::decay<Fn>::type;
+		static_assert(std::is_copy_constructible<F>::value, "Multicast handlers must be copy constructible");
+		static_assert(alignof(F) <= alignof(std::max_align_t), "Over-aligned functors are not supported by multicast");
+		using handler = detail::multicast_handler<F, RetType, Args...>;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		snapshot *old = current.load();
+		snapshot_builder builder(*this, (old ? old->bytes : 0) + handler::stride);
+		for (entry *it = begin(old), *end_it = end(old); it != end_it; it = next(it)) {
+			builder.append_copy(it);
+		}
+		subscription id = ++last_id;
+		builder.append(&handler::ops, id, std::forward<Fn>(fn));
+		publish(builder.release());
+		return id;
+	}
+
+	/**
+	 * Unsubscribe the handler identified by `id`.
+	 * @return Whether a handler was unsubscribed.
+	 */
+	bool unsubscribe(subscription id) {
+		std::lock_guard<std::mutex> lock(mutex);
+		snapshot *old = current.load();
+		entry *found = find(old, id);
+		if (!found) {
+			return false;
+		}
+		snapshot_builder builder(*this, old->bytes - found->ops->stride);
+		for (entry *it = begin(old), *end_it = end(old); it != end_it; it = next(it)) {
+			if (it != found) {
+				builder.append_copy(it);
+			}
+		}
+		publish(builder.release());
+		return true;
+	}
+
+	/// Unsubscribe all handlers.
+	void clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		publish(nullptr);
+	}
+
+	/// Number of subscribed handlers.
+	std::size_t size() const {
+		read_guard guard(*this);
+		return guard.current ? guard.current->count : 0;
+	}
+
+	/// Invoke every subscribed handler in order of subscription.
+	RetType operator()(Args... args) const {
+		read_guard guard(*this);
+		return dispatch(guard.current, std::is_void<RetType>(), args...);
+	}
+
+	/**
+	 * Get a [userdata, invoker] tuple that dispatches to the subscribed handlers.
+	 *
+	 * The invoker accepts the same parameters as the handlers, with the addition of the `userdata` prefix argument.
+	 */
+	std::tuple<void*, RetType (*)(void*, Args...)> prefix_invoker() {
+		return std::make_tuple(static_cast<void*>(this), invoke_prefix);
+	}
+
+	/**
+	 * Same as `prefix_invoker` where the invoker accepts userdata parameter suffix instead of prefix.
+	 */
+	std::tuple<RetType (*)(Args..., void*), void*> suffix_invoker() {
+		return std::make_tuple(invoke_suffix, static_cast<void*>(this));
+	}
+
+	static RetType invoke_prefix(void *userdata, Args... args) {
+		read_guard guard(*static_cast<const multicast*>(userdata));
+		return dispatch(guard.current, std::is_void<RetType>(), args...);
+	}
+
+	static RetType invoke_suffix(Args... args, void *userdata) {
+		read_guard guard(*static_cast<const multicast*>(userdata));
+		return dispatch(guard.current, std::is_void<RetType>(), args...);
+	}
+
+private:
+	using entry = detail::multicast_entry<RetType, Args...>;
+	using ops_type = detail::multicast_ops<RetType, Args...>;
+
+	/**
+	 * Buffer of handlers plus the number of dispatches reading it.
+	 * Snapshots are recycled instead of deleted until the multicast is destroyed, so that readers can always access their count,
+	 * even if they loaded a snapshot that was replaced in the meantime.
+	 */
+	struct snapshot {
+		snapshot() : readers(0), buffer(nullptr), count(0), bytes(0), next(nullptr) {}
+
+		std::atomic<std::size_t> readers;
+		char *buffer;
+		std::size_t count;
+		std::size_t bytes;
+		/// Next snapshot in the retired or free list.
+		snapshot *next;
+	};
+
+	static entry *begin(snapshot *s) {
+		return s ? reinterpret_cast<entry*>(s->buffer) : nullptr;
+	}
+	static entry *end(snapshot *s) {
+		return s ? reinterpret_cast<entry*>(s->buffer + s->bytes) : nullptr;
+	}
+	static entry *next(entry *e) {
+		return reinterpret_cast<entry*>(reinterpret_cast<char*>(e) + e->ops->stride);
+	}
+	static void *functor(entry *e) {
+		return reinterpret_cast<char*>(e) + e->ops->offset;
+	}
+	static entry *find(snapshot *s, subscription id) {
+		for (entry *it = begin(s), *end_it = end(s); it != end_it; it = next(it)) {
+			if (it->id == id) {
+				return it;
+			}
+		}
+		return nullptr;
+	}
+
+	/// Destroy the handlers of `s` and free its buffer.
+	static void free_buffer(snapshot *s) {
+		for (entry *it = begin(s), *end_it = end(s); it != end_it; it = next(it)) {
+			it->ops->destroy(functor(it));
+		}
+		::operator delete(s->buffer);
+		s->buffer = nullptr;
+		s->count = 0;
+		s->bytes = 0;
+	}
+
+	/// Free every snapshot in the list starting at `s`.
+	static void delete_snapshots(snapshot *s) {
+		while (s) {
+			snapshot *next_snapshot = s->next;
+			free_buffer(s);
+			delete s;
+			s = next_snapshot;
+		}
+	}
+
+	/// Get a snapshot with an empty buffer of `capacity` bytes, reusing a free one if possible. Must be called with the mutex locked.
+	snapshot *allocate_snapshot(std::size_t capacity) {
+		char *buffer = static_cast<char*>(::operator new(capacity));
+		snapshot *s = free_snapshots;
+		if (s) {
+			free_snapshots = s->next;
+		}
+		else {
+			try {
+				s = new snapshot();
+			}
+			catch (...) {
+				::operator delete(buffer);
+				throw;
+			}
+		}
+		s->buffer = buffer;
+		s->next = nullptr;
+		return s;
+	}
+
+	/// Free the buffer of `s` and move it to the free list. Must be called with the mutex locked.
+	void recycle(snapshot *s) {
+		free_buffer(s);
+		s->next = free_snapshots;
+		free_snapshots = s;
+	}
+
+	/// Builds a new snapshot, destroying the handlers copied so far if an exception is thrown.
+	class snapshot_builder {
+	public:
+		snapshot_builder(multicast& owner, std::size_t capacity)
+			: owner(owner)
+			, result(owner.allocate_snapshot(capacity))
+		{
+		}
+		snapshot_builder(const snapshot_builder&) = delete;
+		snapshot_builder& operator=(const snapshot_builder&) = delete;
+		~snapshot_builder() {
+			if (result) {
+				owner.recycle(result);
+			}
+		}
+
+		void append_copy(entry *e) {
+			entry *it = end(result);
+			e->ops->copy(reinterpret_cast<char*>(it) + e->ops->offset, functor(e));
+			commit(new (it) entry(*e));
+		}
+
+		template<typename Fn>
+		void append(const ops_type *ops, subscription id, Fn&& fn) {
+			entry *it = end(result);
+			new (reinterpret_cast<char*>(it) + ops->offset) typename std::decay<Fn>::type(std::forward<Fn>(fn));
+			commit(new (it) entry { ops, id });
+		}
+
+		snapshot *release() {
+			snapshot *s = result;
+			result = nullptr;
+			return s;
+		}
+
+	private:
+		void commit(entry *e) {
+			result->count++;
+			result->bytes += e->ops->stride;
+		}
+
+		multicast& owner;
+		snapshot *result;
+	};
+
+	/// Marks a dispatch in progress on the current snapshot, so that writers don't free it while it is being read.
+	struct read_guard {
+		explicit read_guard(const multicast& owner) {
+			current = owner.current.load();
+			// Sequentially consistent ordering makes sure writers either see this reader or it sees their new snapshot
+			while (current) {
+				current->readers.fetch_add(1);
+				snapshot *validated = owner.current.load();
+				if (validated == current) {
+					break;
+				}
+				current->readers.fetch_sub(1);
+				current = validated;
+			}
+		}
+		~read_guard() {
+			if (current) {
+				current->readers.fetch_sub(1);
+			}
+		}
+
+		snapshot *current;
+	};
+
+	static RetType dispatch(snapshot *s, std::true_type /* is_void */, Args&... args) {
+		for (entry *it = begin(s), *end_it = end(s); it != end_it; it = next(it)) {
+			it->ops->invoke(functor(it), static_cast<typename detail::multicast_argument<Args>::type>(args)...);
+		}
+	}
+
+	static RetType dispatch(snapshot *s, std::false_type /* is_void */, Args&... args) {
+		RetType result {};
+		for (entry *it = begin(s), *end_it = end(s); it != end_it; it = next(it)) {
+			result = it->ops->invoke(functor(it), static_cast<typename detail::multicast_argument<Args>::type>(args)...);
+		}
+		return result;
+	}
+
+	/**
+	 * Replace the current snapshot, retiring the old one, then recycle every retired snapshot that is not being read.
+	 * Retired snapshots are kept only by dispatches in progress, so there are never more of them than concurrent dispatches.
+	 * Must be called with the mutex locked.
+	 */
+	void publish(snapshot *s) {
+		snapshot *old = current.exchange(s);
+		if (old) {
+			old->next = retired;
+			retired = old;
+		}
+		for (snapshot **it = &retired; *it;) {
+			snapshot *r = *it;
+			if (r->readers.load() == 0) {
+				*it = r->next;
+				recycle(r);
+			}
+			else {
+				it = &r->next;
+			}
+		}
+	}
+
+	std::atomic<snapshot*> current { nullptr };
+	std::mutex mutex;
+	snapshot *retired = nullptr;
+	snapshot *free_snapshots = nullptr;
+	subscription last_id = 0;
+};
+
+/**
+ * Fixed-capacity table of callbacks identified by integer handles instead of pointers.
+ *
+ * Functors are stored in place, in a dense array of `Capacity` slots of `SlotSize` bytes.
+ * Handles encode the slot index plus a generation that changes whenever the slot is released,
+ * so invoking or erasing a stale handle is detected and ignored, instead of being a use-after-free.
+ * This suits C APIs with integer context fields, like io_uring's `user_data` or epoll's `data.u64`.
+ * Inserting and erasing are O(1) and lock-free, and invoking takes no lock.
+ *
+ * Invoking a stale handle returns a value-initialized `RetType`.
+ *
+ * @warning Erasing a handle while it is being invoked in another thread is undefined behaviour.
+ *
+ * @code
+ * functor2c::handle_table<void(int), 1024> callbacks;
+ * auto handle = callbacks.insert([](int result) {});
+ * sqe->user_data = handle;
+ * // ...
+ * callbacks.invoke(cqe->user_data, cqe->res);
+ * callbacks.erase(cqe->user_data);
+ * @endcode
+ */
+template<typename Signature, std::size_t Capacity, std::size_t SlotSize = 4 * sizeof(void*)>
+class handle_table;
+
+template<typename RetType, typename... Args, std::size_t Capacity, std::size_t SlotSize>
+class handle_table<RetType(Args...), Capacity, SlotSize> {
+	static_assert(Capacity > 0 && Capacity < UINT32_MAX, "handle_table capacity must be between 1 and UINT32_MAX - 1");
+
+public:
+	/// Integer handle identifying a callback. Zero is never a valid handle.
+	using handle = std::uintptr_t;
+
+	handle_table() : free_head(0) {
+		for (std::size_t i = 0; i < Capacity; i++) {
+			slots[i].generation.store(0, std::memory_order_relaxed);
+			slots[i].next_free.store(i + 1 < Capacity ? i + 2 : 0, std::memory_order_relaxed);
+		}
+		free_head.store(1, std::memory_order_release);
+	}
+	handle_table(const handle_table&) = delete;
+	handle_table& operator=(const handle_table&) = delete;
+	~handle_table() {
+		for (slot& s : slots) {
+			if (s.generation.load(std::memory_order_relaxed) % 2) {
+				s.destroy(&s.storage);
+			}
+		}
+	}
+
+	/**
+	 * Store `fn` in a free slot.
+	 * @throws std::bad_alloc if the table is full.
+	 * @return Handle used for invoking and erasing the callback.
+	 */
+	template<typename Fn>
+	handle insert(Fn&& fn) {
+		using F = typename std::decay<Fn>::type;
+		static_assert(sizeof(F) <= SlotSize, "Functor does not fit in handle_table slot size");
+		static_assert(alignof(F) <= alignof(std::max_align_t), "Over-aligned functors are not supported by handle_table");
+
+		std::uint32_t index = pop_free();
+		slot& s = slots[index];
+		new (&s.storage) F(std::forward<Fn>(fn));
+		s.invoke = detail::function_ref<F, RetType, Args...>::invoke;
+		s.destroy = destroy_functor<F>;
+		std::uintptr_t generation = s.generation.load(std::memory_order_relaxed) + 1;
+		s.generation.store(generation, std::memory_order_release);
+		return encode(index, generation);
+	}
+
+	/**
+	 * Destroy the callback identified by `h` and release its slot.
+	 * @return Whether `h` was a live handle.
+	 */
+	bool erase(handle h) {
+		std::uintptr_t generation = h / Capacity;
+		std::uint32_t index = h % Capacity;
+		slot& s = slots[index];
+		std::uintptr_t current = s.generation.load(std::memory_order_acquire);
+		// Only one of concurrent erases of the same handle succeeds
+		do {
+			if (!is_live(current, generation)) {
+				return false;
+			}
+		} while (!s.generation.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire));
+		s.destroy(&s.storage);
+		push_free(index);
+		return true;
+	}
+
+	/// Whether `h` identifies a live callback.
+	bool contains(handle h) const {
+		return is_live(slots[h % Capacity].generation.load(std::memory_order_acquire), h / Capacity);
+	}
+
+	/// Invoke the callback identified by `h`, if it is still live.
+	RetType invoke(handle h, Args... args) {
+		return call(h, std::forward<Args>(args)...);
+	}
+
+	/// Convert handle to the userdata passed to C APIs.
+	static void *userdata(handle h) {
+		return reinterpret_cast<void*>(h);
+	}
+
+	/**
+	 * Invoker that calls the callback identified by `userdata` in the table `Table`.
+	 * Since userdata is a handle and not a pointer, the table is bound at compile time, so it must have static storage duration.
+	 *
+	 * @code
+	 * static functor2c::handle_table<void(int), 64> callbacks;
+	 * register_callback(decltype(callbacks)::invoke_prefix<callbacks>, callbacks.userdata(callbacks.insert([](int) {})));
+	 * @endcode
+	 */
+	template<handle_table& Table>
+	static RetType invoke_prefix(void *userdata, Args... args) {
+		return Table.call(reinterpret_cast<handle>(userdata), std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Same as `invoke_prefix` where the invoker accepts userdata parameter suffix instead of prefix.
+	 */
+	template<handle_table& Table>
+	static RetType invoke_suffix(Args... args, void *userdata) {
+		return Table.call(reinterpret_cast<handle>(userdata), std::forward<Args>(args)...);
+	}
+
+private:
+	/// Invoke the callback identified by `h` with arguments already materialized by the caller, if it is still live.
+	RetType call(handle h, Args&&... args) {
+		slot& s = slots[h % Capacity];
+		if (!is_live(s.generation.load(std::memory_order_acquire), h / Capacity)) {
+			return RetType();
+		}
+		return s.invoke(&s.storage, std::forward<Args>(args)...);
+	}
+
+	struct slot {
+		alignas(std::max_align_t) unsigned char storage[SlotSize];
+		RetType (*invoke)(void*, Args&&...);
+		void (*destroy)(void*);
+		// Odd generations mark live slots
+		std::atomic<std::uintptr_t> generation;
+		std::atomic<std::uint32_t> next_free;
+	};
+
+	/// Generations wrap around at this even value, so that encoded handles never overflow and keep their parity.
+	static constexpr std::uintptr_t generation_limit = (UINTPTR_MAX / Capacity) & ~std::uintptr_t(1);
+
+	static handle encode(std::uint32_t index, std::uintptr_t generation) {
+		return generation % generation_limit * Capacity + index;
+	}
+
+	static bool is_live(std::uintptr_t slot_generation, std::uintptr_t handle_generation) {
+		return slot_generation % 2 && slot_generation % generation_limit == handle_generation;
+	}
+
+	template<typename F>
+	static void destroy_functor(void *userdata) {
+		static_cast<F*>(userdata)->~F();
+	}
+
+	// Free list head packs an ABA tag in the upper 32 bits and the 1-based index of the first free slot in the lower 32 bits
+	std::uint32_t pop_free() {
+		std::uint64_t head = free_head.load(std::memory_order_acquire);
+		std::uint64_t new_head;
+		do {
+			std::uint32_t first = head & UINT32_MAX;
+			if (first == 0) {
+				throw std::bad_alloc();
+			}
+			std::uint64_t tag = (head >> 32) + 1;
+			new_head = (tag << 32) | slots[first - 1].next_free.load(std::memory_order_relaxed);
+		} while (!free_head.compare_exchange_weak(head, new_head, std::memory_order_acq_rel, std::memory_order_acquire));
+		return (head & UINT32_MAX) - 1;
+	}
+
+	void push_free(std::uint32_t index) {
+		std::uint64_t head = free_head.load(std::memory_order_relaxed);
+		std::uint64_t new_head;
+		do {
+			slots[index].next_free.store(head & UINT32_MAX, std::memory_order_relaxed);
+			std::uint64_t tag = (head >> 32) + 1;
+			new_head = (tag << 32) | (index + 1);
+		} while (!free_head.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	slot slots[Capacity];
+	std::atomic<std::uint64_t> free_head;
+};
+template<typename RetType, typename... Args, std::size_t Capacity, std::size_t SlotSize>
+constexpr std::uintptr_t handle_table<RetType(Args...), Capacity, SlotSize>::generation_limit;
+
+namespace detail {
+
+/**
+ * Compile-time sequence of indices, used for unpacking tuples in C++11.
+ * @private
+ */
+template<std::size_t... Indices>
+struct index_sequence {};
+
+template<std::size_t N, std::size_t... Indices>
+struct make_index_sequence : make_index_sequence<N - 1, N - 1, Indices...> {};
+
+template<std::size_t... Indices>
+struct make_index_sequence<0, Indices...> {
+	using type = index_sequence<Indices...>;
+};
+
+}
+
+#ifdef FUNCTOR2C_ASYNC
+/**
+ * What an asynchronous invoker does when its queue is full, or when its executor rejects the task that runs the call.
+ */
+enum class overflow_policy {
+	/// Wait for space for at most `async_options::max_enqueue_wait`, dropping the call on timeout.
+	block,
+	/// Drop the call right away.
+	drop,
+	/// Run the functor inline, in the calling thread.
+	run_inline,
+};
+
+/**
+ * Configuration for asynchronous invokers.
+ */
+struct async_options {
+	/// Maximum number of pending calls, rounded up to a power of two.
+	std::size_t capacity = 256;
+	/// What to do with calls made while the queue is full.
+	overflow_policy overflow = overflow_policy::block;
+	/// Maximum time spent waiting for space in the queue with `overflow_policy::block`. Defaults to waiting forever.
+	std::chrono::nanoseconds max_enqueue_wait = std::chrono::nanoseconds::max();
+};
+
+namespace detail {
+
+/**
+ * Bounded lock-free multi-producer multi-consumer queue, by Dmitry Vyukov.
+ *
+ * Each cell has a sequence number telling whether it is ready to be written or read at a given position,
+ * so producers and consumers only contend on their own position counters.
+ * @private
+ */
+template<typename T>
+class mpmc_queue {
+public:
+	explicit mpmc_queue(std::size_t capacity)
+		: mask(round_up_to_power_of_two(capacity) - 1)
+		, cells(new cell[mask + 1])
+		, enqueue_position(0)
+		, dequeue_position(0)
+	{
+		for (std::size_t i = 0; i <= mask; i++) {
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+	mpmc_queue(const mpmc_queue&) = delete;
+	mpmc_queue& operator=(const mpmc_queue&) = delete;
+	~mpmc_queue() {
+		while (try_pop(discard())) {}
+	}
+
+	/// Construct a value from `values` in the queue, unless it is full.
+	template<typename... Values>
+	bool try_push(Values&&... values) {
+		std::size_t position = enqueue_position.load(std::memory_order_relaxed);
+		cell *c;
+		for (;;) {
+			c = &cells[position & mask];
+			std::intptr_t difference = (std::intptr_t) c->sequence.load(std::memory_order_acquire) - (std::intptr_t) position;
+			if (difference == 0) {
+				if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (difference < 0) {
+				return false;
+			}
+			else {
+				position = enqueue_position.load(std::memory_order_relaxed);
+			}
+		}
+		new (&c->storage) T(std::forward<Values>(values)...);
+		c->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Pass the first value in the queue to `consume`, then destroy it, unless the queue is empty.
+	template<typename Consumer>
+	bool try_pop(Consumer&& consume) {
+		std::size_t position = dequeue_position.load(std::memory_order_relaxed);
+		cell *c;
+		for (;;) {
+			c = &cells[position & mask];
+			std::intptr_t difference = (std::intptr_t) c->sequence.load(std::memory_order_acquire) - (std::intptr_t) (position + 1);
+			if (difference == 0) {
+				if (dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (difference < 0) {
+				return false;
+			}
+			else {
+				position = dequeue_position.load(std::memory_order_relaxed);
+			}
+		}
+		release_guard guard { c, position + mask + 1 };
+		consume(*reinterpret_cast<T*>(&c->storage));
+		return true;
+	}
+
+private:
+	struct cell {
+		std::atomic<std::size_t> sequence;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	/// Destroys the popped value and hands its cell back to producers, even if the consumer throws.
+	struct release_guard {
+		cell *c;
+		std::size_t next_sequence;
+
+		~release_guard() {
+			reinterpret_cast<T*>(&c->storage)->~T();
+			c->sequence.store(next_sequence, std::memory_order_release);
+		}
+	};
+
+	struct discard {
+		void operator()(T&) const {}
+	};
+
+	static std::size_t round_up_to_power_of_two(std::size_t value) {
+		std::size_t result = 2;
+		while (result < value) {
+			result *= 2;
+		}
+		return result;
+	}
+
+	std::size_t mask;
+	std::unique_ptr<cell[]> cells;
+	// Padding keeps producer and consumer positions in separate cache lines
+	char padding0[64];
+	std::atomic<std::size_t> enqueue_position;
+	char padding1[64];
+	std::atomic<std::size_t> dequeue_position;
+	char padding2[64];
+};
+
+/**
+ * Call `executor.execute(function, userdata)`, returning whether the executor accepted the task.
+ * Executors may return `bool` from `execute`, while executors returning nothing always accept tasks.
+ * @private
+ */
+template<typename Executor>
+auto execute_task(Executor& executor, void (*function)(void*), void *userdata, int) -> decltype(bool(executor.execute(function, userdata))) {
+	return executor.execute(function, userdata);
+}
+
+template<typename Executor>
+bool execute_task(Executor& executor, void (*function)(void*), void *userdata, long) {
+	executor.execute(function, userdata);
+	return true;
+}
+
+/**
+ * Lets threads sleep until an attempt succeeds, where threads that make it succeed call `notify`.
+ *
+ * Notifying only locks when some thread is sleeping, so it stays cheap in the common case.
+ * @private
+ */
+class event_count {
+public:
+	event_count() : waiting(0), epoch(0) {}
+
+	/// Wake up sleeping threads, to be called after every change that may make their attempts succeed.
+	void notify() {
+		// Read-modify-write operations on `waiting` are totally ordered,
+		// so either sleeping threads are seen here, or their next attempt sees the changes made before notifying
+		if (waiting.fetch_add(0, std::memory_order_acq_rel) > 0) {
+			std::lock_guard<std::mutex> lock(mutex);
+			epoch++;
+			condition.notify_all();
+		}
+	}
+
+	/**
+	 * Call `attempt` until it succeeds, sleeping until notified between attempts.
+	 * @return Whether `attempt` succeeded before `deadline`.
+	 */
+	template<typename Attempt>
+	bool wait_until(Attempt attempt, std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) {
+		while (!attempt()) {
+			waiting.fetch_add(1, std::memory_order_acq_rel);
+			std::unique_lock<std::mutex> lock(mutex);
+			std::size_t key = epoch;
+			lock.unlock();
+			bool succeeded = attempt();
+			bool notified = true;
+			if (!succeeded) {
+				lock.lock();
+				if (deadline == std::chrono::steady_clock::time_point::max()) {
+					condition.wait(lock, [&] { return epoch != key; });
+				}
+				else {
+					notified = condition.wait_until(lock, deadline, [&] { return epoch != key; });
+				}
+				lock.unlock();
+			}
+			waiting.fetch_sub(1, std::memory_order_relaxed);
+			if (succeeded) {
+				return true;
+			}
+			if (!notified) {
+				return attempt();
+			}
+		}
+		return true;
+	}
+
+private:
+	std::atomic<std::size_t> waiting;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::size_t epoch;
+};
+
+/**
+ * Wrapper that packs call arguments into a queue, running `Fn` with them later on an executor.
+ *
+ * Every call in the queue is popped by a single task, and each scheduled task holds a reference to the wrapper,
+ * so the wrapper is only deleted once both its owner and every scheduled task released it.
+ * @private
+ */
+template<typename Fn, typename Executor, typename... Args>
+struct async_function {
+	using arguments = std::tuple<typename std::decay<Args>::type...>;
+
+	template<typename F>
+	static std::tuple<void*, void (*)(void*, Args...), void (*)(void*)> prefix_invoker(Executor& executor, F&& fn, const async_options& options) {
+		return std::make_tuple(new async_function(executor, std::forward<F>(fn), options), invoke_prefix, destroy);
+	}
+
+	template<typename F>
+	static std::tuple<void (*)(Args..., void*), void*, void (*)(void*)> suffix_invoker(Executor& executor, F&& fn, const async_options& options) {
+		return std::make_tuple(invoke_suffix, new async_function(executor, std::forward<F>(fn), options), destroy);
+	}
+
+	static void invoke_prefix(void *userdata, Args... args) {
+		static_cast<async_function*>(userdata)->enqueue(args...);
+	}
+
+	static void invoke_suffix(Args... args, void *userdata) {
+		static_cast<async_function*>(userdata)->enqueue(args...);
+	}
+
+	/**
+	 * Run the calls not picked up by the executor yet in the calling thread, wait for the ones already picked up to finish,
+	 * then release the wrapper.
+	 * Tasks the executor has not run yet find the queue empty, and the last of them deletes the wrapper.
+	 * Calls running in the calling thread are not waited for, so the functor may release its own wrapper.
+	 */
+	static void destroy(void *userdata) {
+		async_function *self = static_cast<async_function*>(userdata);
+		self->closing.store(true);
+		self->events.notify();
+		while (self->queue.try_pop(call { self })) {}
+		std::size_t running = running_calls(self);
+		self->events.wait_until([self, running] {
+			return self->finished.load(std::memory_order_acquire) + running == self->pushed.load(std::memory_order_relaxed);
+		});
+		self->release();
+	}
+
+private:
+	template<typename F>
+	async_function(Executor& executor, F&& fn, const async_options& options)
+		: function(std::forward<F>(fn))
+		, executor(executor)
+		, options(options)
+		, queue(options.capacity)
+		, references(1)
+		, pushed(0)
+		, finished(0)
+		, closing(false)
+	{
+	}
+
+	/// Marks a popped call as finished, even if the functor throws, tracking it as running in the current thread meanwhile.
+	struct finish_guard {
+		async_function *self;
+		finish_guard *outer;
+
+		finish_guard(async_function *self) : self(self), outer(innermost_call()) {
+			innermost_call() = this;
+		}
+		finish_guard(const finish_guard&) = delete;
+		finish_guard& operator=(const finish_guard&) = delete;
+		~finish_guard() {
+			innermost_call() = outer;
+			self->finished.fetch_add(1, std::memory_order_release);
+		}
+	};
+
+	static finish_guard*& innermost_call() {
+		static thread_local finish_guard *call = nullptr;
+		return call;
+	}
+
+	/// Number of popped calls to `self` running in the current thread.
+	static std::size_t running_calls(async_function *self) {
+		std::size_t count = 0;
+		for (finish_guard *call = innermost_call(); call; call = call->outer) {
+			if (call->self == self) {
+				count++;
+			}
+		}
+		return count;
+	}
+
+	/// Releases a reference to the wrapper on scope exit.
+	struct release_guard {
+		async_function *self;
+
+		~release_guard() {
+			self->release();
+		}
+	};
+
+	struct call {
+		async_function *self;
+
+		void operator()(arguments& args) const {
+			finish_guard guard { self };
+			self->apply(args, typename make_index_sequence<sizeof...(Args)>::type());
+		}
+	};
+
+	struct drop_call {
+		async_function *self;
+
+		void operator()(arguments&) const {
+			finish_guard guard { self };
+		}
+	};
+
+	template<std::size_t... Indices>
+	void apply(arguments& args, index_sequence<Indices...>) {
+		function(std::get<Indices>(std::move(args))...);
+	}
+
+	void release() {
+		if (references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			delete this;
+		}
+	}
+
+	void enqueue(Args&... args) {
+		if (!retry([&] { return queue.try_push(std::forward<Args>(args)...); })) {
+			if (options.overflow == overflow_policy::run_inline) {
+				// The functor may release its own wrapper
+				references.fetch_add(1, std::memory_order_relaxed);
+				release_guard guard { this };
+				function(std::forward<Args>(args)...);
+			}
+			return;
+		}
+		pushed.fetch_add(1, std::memory_order_relaxed);
+		references.fetch_add(1, std::memory_order_relaxed);
+		// Wake up tasks waiting for a value written by this push
+		events.notify();
+		bool accepted;
+		try {
+			// Executors do not notify when they accept tasks again, so they are polled
+			accepted = retry([this] { return execute_task(executor, run, this, 0); }, std::chrono::milliseconds(1));
+		}
+		catch (...) {
+			drop(this);
+			throw;
+		}
+		if (!accepted) {
+			// The executor is full as well, so the overflow policy applies to a queued call in the calling thread
+			if (options.overflow == overflow_policy::run_inline) {
+				run(this);
+			}
+			else {
+				drop(this);
+			}
+		}
+	}
+
+	/**
+	 * Call `attempt` until it succeeds, waiting for at most `max_enqueue_wait` with `overflow_policy::block`.
+	 * Waits are woken up by calls popped from the queue, or after `poll_interval` for attempts that nothing notifies.
+	 */
+	template<typename Attempt>
+	bool retry(Attempt attempt, std::chrono::steady_clock::duration poll_interval = std::chrono::steady_clock::duration::max()) {
+		if (attempt()) {
+			return true;
+		}
+		if (options.overflow != overflow_policy::block) {
+			return false;
+		}
+		bool wait_forever = options.max_enqueue_wait == std::chrono::nanoseconds::max();
+		std::chrono::steady_clock::time_point deadline = wait_forever
+			? std::chrono::steady_clock::time_point::max()
+			: std::chrono::steady_clock::now() + options.max_enqueue_wait;
+		for (;;) {
+			std::chrono::steady_clock::time_point until = deadline;
+			if (poll_interval != std::chrono::steady_clock::duration::max()) {
+				until = std::min(deadline, std::chrono::steady_clock::now() + poll_interval);
+			}
+			if (events.wait_until(attempt, until)) {
+				return true;
+			}
+			if (until == deadline) {
+				return false;
+			}
+		}
+	}
+
+	static void run(void *userdata) {
+		async_function *self = static_cast<async_function*>(userdata);
+		release_guard guard { self };
+		// Every push schedules a single run, but the value at the front of the queue may still be being written by another producer.
+		// Once the deleter is called there are no producers anymore, and the deleter may have run this task's call itself.
+		self->events.wait_until([self] { return self->queue.try_pop(call { self }) || self->closing.load(); });
+		// Wake up producers waiting for space and the deleter waiting for this call
+		self->events.notify();
+	}
+
+	/// Pop a queued call without running it, for a task that the executor did not accept.
+	static void drop(async_function *self) {
+		release_guard guard { self };
+		self->events.wait_until([self] { return self->queue.try_pop(drop_call { self }); });
+		self->events.notify();
+	}
+
+	Fn function;
+	Executor& executor;
+	async_options options;
+	mpmc_queue<arguments> queue;
+	std::atomic<std::size_t> references;
+	std::atomic<std::size_t> pushed;
+	std::atomic<std::size_t> finished;
+	std::atomic<bool> closing;
+	event_count events;
+};
+
+}
+
+/**
+ * Fixed-size pool of worker threads, usable as the executor of asynchronous invokers.
+ *
+ * Tasks are pushed to a lock-free queue, and idle workers sleep until tasks are available.
+ * If the queue is full, tasks are rejected, so that asynchronous invokers apply their own overflow policy.
+ * The destructor runs every task already queued, then joins the workers.
+ *
+ * Only available when `FUNCTOR2C_ASYNC` is defined before including this header, since it needs the threading headers.
+ */
+class thread_pool {
+public:
+	explicit thread_pool(std::size_t thread_count = std::thread::hardware_concurrency(), std::size_t capacity = 1024)
+		: tasks(capacity)
+		, available(0)
+		, stopping(false)
+	{
+		if (thread_count == 0) {
+			thread_count = 1;
+		}
+		for (std::size_t i = 0; i < thread_count; i++) {
+			workers.emplace_back(&thread_pool::work, this);
+		}
+	}
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+	~thread_pool() {
+		stopping.store(true);
+		events.notify();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	/**
+	 * Run `function(userdata)` in one of the worker threads.
+	 * @return Whether the task was queued, or false without running it if the queue is full.
+	 */
+	bool execute(void (*function)(void*), void *userdata) {
+		if (!tasks.try_push(task { function, userdata })) {
+			return false;
+		}
+		available.fetch_add(1);
+		events.notify();
+		return true;
+	}
+
+private:
+	struct task {
+		void (*function)(void*);
+		void *userdata;
+	};
+
+	struct take_task {
+		task *t;
+
+		void operator()(task& value) const {
+			*t = value;
+		}
+	};
+
+	bool claim() {
+		std::size_t count = available.load();
+		while (count > 0) {
+			if (available.compare_exchange_weak(count, count - 1)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void work() {
+		for (;;) {
+			bool claimed = false;
+			events.wait_until([&] { return (claimed = claim()) || stopping.load(); });
+			if (!claimed) {
+				return;
+			}
+			// Claimed tasks may still be being written by their producer, which notifies when done
+			task t;
+			events.wait_until([&] { return tasks.try_pop(take_task { &t }); });
+			t.function(t.userdata);
+		}
+	}
+
+	detail::mpmc_queue<task> tasks;
+	std::atomic<std::size_t> available;
+	std::atomic<bool> stopping;
+	detail::event_count events;
+	std::vector<std::thread> workers;
+};
+
+/**
+ * Transform `fn` into a [userdata, invoker, deleter] tuple, where the invoker enqueues calls to run `fn` on `executor`.
+ *
+ * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ * It moves decayed copies of the arguments into a preallocated slot of a lock-free queue and returns right away,
+ * so C libraries calling it from their own threads are never stalled by `fn`.
+ * Any return value of `fn` is discarded.
+ *
+ * `executor` is any object with an `execute(void (*)(void*), void*)` method that eventually calls the function with the userdata,
+ * like `thread_pool`. It must outlive the returned userdata.
+ * `execute` may return a `bool`, where false means the task was rejected, like when the executor's own queue is full.
+ * Rejected tasks are handled according to `options.overflow`, just like calls made while the invoker's queue is full.
+ * If the executor runs tasks concurrently, `fn` may be called concurrently as well.
+ *
+ * Only available when `FUNCTOR2C_ASYNC` is defined before including this header, since it needs the threading headers.
+ *
+ * @note You are responsible for calling the deleter with the userdata as parameter to reclaim allocated memory.
+ *       The deleter runs every call the executor did not pick up yet in the calling thread, then waits for the ones already picked up,
+ *       so `fn` is not called after it returns, and the invoker must not be called anymore.
+ *       It may also be called from inside `fn`, in which case it does not wait for the calls running in the same thread,
+ *       and memory is reclaimed once they return.
+ *       If the executor never runs its tasks, memory is only reclaimed once it does.
+ *
+ * @code
+ * functor2c::thread_pool pool(4);
+ * functor2c::async_options options;
+ * options.capacity = 1024;
+ * options.overflow = functor2c::overflow_policy::drop;
+ * auto [userdata, invoker, deleter] = functor2c::prefix_invoker_async<void, int>(pool, [](int event) {}, options);
+ * invoker(userdata, 42);
+ * deleter(userdata);
+ * @endcode
+ *
+ * @return Tuple containing an opaque userdata, plus invoker and deleter functions.
+ */
+template<typename RetType, typename... Args, typename Executor, typename Fn>
+std::tuple<void*, void (*)(void*, Args...), void (*)(void*)> prefix_invoker_async(Executor& executor, Fn&& fn, const async_options& options = async_options()) {
+	static_assert(std::is_void<RetType>::value, "Asynchronous invokers cannot return values");
+	return detail::async_function<typename std::decay<Fn>::type, Executor, Args...>::prefix_invoker(executor, std::forward<Fn>(fn), options);
+}
+
+/**
+ * Same as `prefix_invoker_async` where the invoker accepts userdata parameter suffix instead of prefix.
+ */
+template<typename RetType, typename... Args, typename Executor, typename Fn>
+std::tuple<void (*)(Args..., void*), void*, void (*)(void*)> suffix_invoker_async(Executor& executor, Fn&& fn, const async_options& options = async_options()) {
+	static_assert(std::is_void<RetType>::value, "Asynchronous invokers cannot return values");
+	return detail::async_function<typename std::decay<Fn>::type, Executor, Args...>::suffix_invoker(executor, std::forward<Fn>(fn), options);
+}
+#endif
+
+
+/**
+ * Table of `N` static trampolines, for C APIs that accept no userdata at all, without runtime code generation.
+ *
+ * Each trampoline is a distinct function instantiated at compile time, that invokes the functor stored in its own global slot.
+ * Slots are acquired and released with lock-free operations over a bitmap.
+ * Use different `Tag` types for independent tables with the same signature.
+ *
+ * @code
+ * using atexit_slots = functor2c::slot_table<void(), 8>;
+ * auto [function, release] = atexit_slots::acquire([&] { flush(logger); });
+ * atexit(function);
+ * @endcode
+ */
+template<typename Signature, std::size_t N, typename Tag = void>
+class slot_table;
+
+template<typename RetType, typename... Args, std::size_t N, typename Tag>
+class slot_table<RetType(Args...), N, Tag> {
+public:
+	using pointer = RetType (*)(Args...);
+
+	slot_table() = delete;
+
+	/**
+	 * Store `fn` in a free slot.
+	 * @throws std::bad_alloc if every slot is in use.
+	 * @return Tuple containing the slot's trampoline plus a function that destroys `fn` and releases the slot.
+	 */
+	template<typename Fn>
+	static std::tuple<pointer, void (*)()> acquire(Fn&& fn) {
+		using wrapper = detail::function_wrapper_for<false, Fn, RetType, Args...>;
+		std::unique_ptr<void, void (*)(void*)> guard(wrapper::create(std::forward<Fn>(fn)), wrapper::destroy);
+		std::size_t index = claim();
+		slots[index].userdata = guard.release();
+		slots[index].invoke = wrapper::template invoke<Args...>;
+		slots[index].destroy = wrapper::destroy;
+		return entry(index, typename detail::make_index_sequence<N>::type());
+	}
+
+private:
+	struct slot {
+		void *userdata;
+		RetType (*invoke)(void*, Args&&...);
+		void (*destroy)(void*);
+	};
+
+	static constexpr std::size_t word_count = (N + 63) / 64;
+
+	template<std::size_t Index>
+	static RetType trampoline(Args... args) {
+		return slots[Index].invoke(slots[Index].userdata, std::forward<Args>(args)...);
+	}
+
+	template<std::size_t Index>
+	static void release() {
+		slots[Index].destroy(slots[Index].userdata);
+		bitmap[Index / 64].fetch_and(~(std::uint64_t(1) << Index % 64), std::memory_order_release);
+	}
+
+	template<std::size_t... Indices>
+	static std::tuple<pointer, void (*)()> entry(std::size_t index, detail::index_sequence<Indices...>) {
+		static const pointer trampolines[] = { trampoline<Indices>... };
+		static void (* const releases[])() = { release<Indices>... };
+		return std::make_tuple(trampolines[index], releases[index]);
+	}
+
+	static std::size_t claim() {
+		for (std::size_t word_index = 0; word_index < word_count; word_index++) {
+			std::uint64_t valid = word_index + 1 < word_count || N % 64 == 0 ? ~std::uint64_t(0) : (std::uint64_t(1) << N % 64) - 1;
+			std::atomic<std::uint64_t>& word = bitmap[word_index];
+			std::uint64_t bits = word.load(std::memory_order_relaxed);
+			while (std::uint64_t free_bits = ~bits & valid) {
+				std::uint64_t lowest = free_bits & (~free_bits + 1);
+				if (word.compare_exchange_weak(bits, bits | lowest, std::memory_order_acquire, std::memory_order_relaxed)) {
+					std::size_t bit = 0;
+					while (lowest >>= 1) {
+						bit++;
+					}
+					return word_index * 64 + bit;
+				}
+			}
+		}
+		throw std::bad_alloc();
+	}
+
+	static slot slots[N];
+	static std::atomic<std::uint64_t> bitmap[word_count];
+};
+template<typename RetType, typename... Args, std::size_t N, typename Tag>
+typename slot_table<RetType(Args...), N, Tag>::slot slot_table<RetType(Args...), N, Tag>::slots[N];
+template<typename RetType, typename... Args, std::size_t N, typename Tag>
+std::atomic<std::uint64_t> slot_table<RetType(Args...), N, Tag>::bitmap[word_count];
+
+/**
+ * RAII guard that makes a single static trampoline call `fn`, for C APIs without userdata that call back synchronously,
+ * like `qsort` or `nftw`.
+ *
+ * The guard pushes a reference to `fn` onto a thread-local stack, one per signature and `Tag`, and pops it when destroyed.
+ * The trampoline always calls the functor on the top of the current thread's stack, so nested guards and re-entrant
+ * callbacks work as expected, with no allocation and no executable memory.
+ *
+ * @warning Only lvalue functors are accepted, since they are referenced and not copied.
+ *          Calling the trampoline in a thread without guards is undefined behaviour.
+ *
+ * @code
+ * std::size_t total_size = 0;
+ * auto visit = [&](const char *path, const struct stat *info, int type, struct FTW *ftw) {
+ *     total_size += info->st_size;
+ *     return 0;
+ * };
+ * functor2c::scoped_tls_invoker<int(const char*, const struct stat*, int, struct FTW*)> guard(visit);
+ * nftw(root, guard.get(), 64, FTW_PHYS);
+ * @endcode
+ */
+template<typename Signature, typename Tag = void>
+class scoped_tls_invoker;
+
+template<typename RetType, typename... Args, typename Tag>
+class scoped_tls_invoker<RetType(Args...), Tag> {
+public:
+	using pointer = RetType (*)(Args...);
+
+	/// Make the trampoline call `fn` in the current thread, until this guard is destroyed.
+	template<typename Fn>
+	explicit scoped_tls_invoker(Fn& fn)
+		: userdata(const_cast<void*>(static_cast<const volatile void*>(std::addressof(fn))))
+		, invoke(detail::function_ref<Fn, RetType, Args...>::invoke)
+		, previous(top())
+	{
+		top() = this;
+	}
+	scoped_tls_invoker(const scoped_tls_invoker&) = delete;
+	scoped_tls_invoker& operator=(const scoped_tls_invoker&) = delete;
+	~scoped_tls_invoker() {
+		top() = previous;
+	}
+
+	/// Trampoline that calls the functor of the innermost guard in the current thread.
+	static RetType trampoline(Args... args) {
+		scoped_tls_invoker *current = top();
+		return current->invoke(current->userdata, std::forward<Args>(args)...);
+	}
+
+	/// Get the trampoline function pointer.
+	pointer get() const {
+		return trampoline;
+	}
+
+private:
+	static scoped_tls_invoker *&top() {
+		static thread_local scoped_tls_invoker *current = nullptr;
+		return current;
+	}
+
+	void *userdata;
+	RetType (*invoke)(void*, Args&&...);
+	scoped_tls_invoker *previous;
+};
+
+#ifdef FUNCTOR2C_HAS_CLOSURE
+
+namespace detail {
+
+/**
+ * Whether every value in `Values` is true.
+ * @private
+ */
+template<bool... Values>
+struct all_true : std::is_same<all_true<true, Values...>, all_true<Values..., true>> {};
+
+/**
+ * Number of arguments passed in general purpose registers by the C calling convention.
+ * @private
+ */
+template<typename... Args>
+struct integer_argument_count : std::integral_constant<unsigned, 0> {};
+
+template<typename First, typename... Rest>
+struct integer_argument_count<First, Rest...> : std::integral_constant<unsigned, (std::is_floating_point<First>::value ? 0 : 1) + integer_argument_count<Rest...>::value> {};
+
+/**
+ * Append the address range of closure thunks to the perf map of the current process, if enabled.
+ * @private
+ */
+inline void register_closure_thunks(const void *code, std::size_t size) {
+#ifdef FUNCTOR2C_CLOSURE_PERF_MAP
+	static std::FILE *perf_map = [] {
+		char path[64];
+		std::snprintf(path, sizeof(path), "/tmp/perf-%ld.map", static_cast<long>(getpid()));
+		return std::fopen(path, "a");
+	}();
+	if (perf_map) {
+		std::fprintf(perf_map, "%lx %lx functor2c::closure thunks\n", reinterpret_cast<unsigned long>(code), static_cast<unsigned long>(size));
+		std::fflush(perf_map);
+	}
+#else
+	(void) code;
+	(void) size;
+#endif
+}
+
+/**
+ * Pool of executable thunks that load a userdata into the general purpose argument register number `Register`
+ * and jump to a target function.
+ *
+ * Memory is allocated in chunks of two pages: thunks live in the code page, mapped read and execute only,
+ * while their userdata and target live at the same offset in the following data page, mapped read and write only.
+ * Since the distance between each thunk and its data is always one page, every thunk in a pool has the same machine code,
+ * which is written once per chunk, and creating a closure only writes to the data page.
+ * Chunks are never unmapped.
+ * @private
+ */
+template<unsigned Register>
+class closure_pool {
+public:
+	static constexpr std::size_t thunk_size = 32;
+
+	static closure_pool& instance() {
+		static closure_pool pool;
+		return pool;
+	}
+
+	/// Get a thunk that calls `target` with `userdata`.
+	void *acquire(void *userdata, void (*target)()) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!free_slots) {
+			allocate_chunk();
+		}
+		slot *s = free_slots;
+		free_slots = s->next_free;
+		s->userdata = userdata;
+		s->target = target;
+		return reinterpret_cast<char*>(s) - page_size;
+	}
+
+	/// Return a thunk acquired from this pool.
+	void release(void *thunk) {
+		slot *s = reinterpret_cast<slot*>(static_cast<char*>(thunk) + page_size);
+		std::lock_guard<std::mutex> lock(mutex);
+		s->next_free = free_slots;
+		free_slots = s;
+	}
+
+private:
+	struct slot {
+		union {
+			void *userdata;
+			slot *next_free;
+		};
+		void (*target)();
+	};
+	static_assert(sizeof(slot) <= thunk_size, "Closure data must fit in thunk size");
+
+	closure_pool() : page_size(sysconf(_SC_PAGESIZE)), free_slots(nullptr) {}
+
+	void allocate_chunk() {
+		void *memory = mmap(nullptr, 2 * page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED) {
+			throw std::bad_alloc();
+		}
+		unsigned char *code = static_cast<unsigned char*>(memory);
+		for (std::size_t offset = 0; offset < page_size; offset += thunk_size) {
+			write_thunk(code + offset);
+		}
+#ifdef PROT_BTI
+		// Guarded pages enforce the thunks' own landing pads
+		const int protection = PROT_READ | PROT_EXEC | PROT_BTI;
+#else
+		const int protection = PROT_READ | PROT_EXEC;
+#endif
+		if (mprotect(code, page_size, protection) != 0) {
+			munmap(memory, 2 * page_size);
+			throw std::bad_alloc();
+		}
+		__builtin___clear_cache(reinterpret_cast<char*>(code), reinterpret_cast<char*>(code + page_size));
+		register_closure_thunks(code, page_size);
+
+		// Push slots in reverse, so that thunks are handed out in address order
+		for (std::size_t offset = page_size; offset > 0; offset -= thunk_size) {
+			slot *s = reinterpret_cast<slot*>(code + page_size + offset - thunk_size);
+			s->next_free = free_slots;
+			free_slots = s;
+		}
+	}
+
+	void write_thunk(unsigned char *thunk) const {
+#if defined(__x86_64__)
+		// rdi, rsi, rdx, rcx, r8, r9
+		static const unsigned char registers[] = { 7, 6, 2, 1, 8, 9 };
+		const unsigned char reg = registers[Register];
+		// endbr64: landing pad for indirect calls with CET indirect branch tracking
+		// mov reg, [rip + page_size - 11]: loads userdata, at the same offset in the data page
+		std::int32_t load_displacement = static_cast<std::int32_t>(page_size - 11);
+		// jmp [rip + page_size - 9]: jumps to target, right after userdata
+		std::int32_t jump_displacement = static_cast<std::int32_t>(page_size + sizeof(void*) - 17);
+		unsigned char instructions[thunk_size] = {
+			0xF3, 0x0F, 0x1E, 0xFA,
+			static_cast<unsigned char>(reg >= 8 ? 0x4C : 0x48), 0x8B, static_cast<unsigned char>(0x05 | (reg & 7) << 3), 0, 0, 0, 0,
+			0xFF, 0x25, 0, 0, 0, 0,
+		};
+		std::memset(instructions + 17, 0xCC, thunk_size - 17);
+		std::memcpy(instructions + 7, &load_displacement, sizeof(load_displacement));
+		std::memcpy(instructions + 13, &jump_displacement, sizeof(jump_displacement));
+#elif defined(__aarch64__)
+		// bti c: landing pad for indirect calls with branch target identification
+		// ldr x<Register>, <pc + page_size - 4>: loads userdata, at the same offset in the data page
+		// ldr x16, <pc + page_size>: loads target, right after userdata
+		// br x16: branches through x16, which `bti c` landing pads in the target accept
+		// brk #0, padding
+		std::uint32_t instructions[thunk_size / 4] = {
+			0xD503245F,
+			static_cast<std::uint32_t>(0x58000000 | ((page_size - 4) / 4) << 5 | Register),
+			static_cast<std::uint32_t>(0x58000000 | (page_size / 4) << 5 | 16),
+			0xD61F0200,
+			0xD4200000,
+			0xD4200000,
+			0xD4200000,
+			0xD4200000,
+		};
+#endif
+		std::memcpy(thunk, instructions, thunk_size);
+	}
+
+	std::size_t page_size;
+	slot *free_slots;
+	std::mutex mutex;
+};
+
+}
+
+/**
+ * Genuine C function pointer bound to a functor, for C APIs that accept no userdata at all, like `atexit` or `qsort`.
+ *
+ * Each closure owns a small machine code thunk that loads the bound userdata into the argument register right after
+ * the last argument and jumps to the suffix invoker of the wrapped functor.
+ * Thunks come from pooled pages that are never writable and executable at the same time, so creating closures is cheap.
+ * Supported on x86-64 and AArch64 Linux, for signatures with scalar arguments and return type only,
+ * with less than 6 (x86-64) or 8 (AArch64) integer or pointer arguments.
+ *
+ * Only available when `FUNCTOR2C_CLOSURE` is defined before including this header, since it needs platform headers
+ * for mapping executable memory. Check `FUNCTOR2C_HAS_CLOSURE` to know whether closures are available.
+ * Thunks start with `endbr64` / `bti c` landing pads, so they work with CET and BTI enforcement.
+ * Define `FUNCTOR2C_CLOSURE_PERF_MAP` for registering thunk pages in `/tmp/perf-<pid>.map`, so that profilers can symbolize them.
+ *
+ * @warning The function pointer is only valid while the closure is alive.
+ *
+ * @code
+ * functor2c::closure<int(const void*, const void*)> compare([&](const void *a, const void *b) {
+ *     return order[*(const int*) a] - order[*(const int*) b];
+ * });
+ * qsort(values, count, sizeof(int), compare.get());
+ * @endcode
+ */
+template<typename Signature>
+class closure;
+
+template<typename RetType, typename... Args>
+class closure<RetType(Args...)> {
+#if defined(__x86_64__)
+	static constexpr unsigned max_integer_arguments = 6;
+#else
+	static constexpr unsigned max_integer_arguments = 8;
+#endif
+	static_assert(detail::all_true<(std::is_scalar<Args>::value || std::is_reference<Args>::value)...>::value, "Closure arguments must be scalars");
+	static_assert(std::is_void<RetType>::value || std::is_scalar<RetType>::value || std::is_reference<RetType>::value, "Closure return type must be void or scalar");
+	static_assert(detail::integer_argument_count<Args...>::value < max_integer_arguments, "Closure userdata must fit in an argument register");
+
+	using pool = detail::closure_pool<detail::integer_argument_count<Args...>::value>;
+
+public:
+	using pointer = RetType (*)(Args...);
+
+	closure() = default;
+
+	/// Wrap `fn` in a new function pointer.
+	template<typename Fn>
+	explicit closure(Fn&& fn) {
+		using wrapper = detail::function_wrapper_for<false, Fn, RetType, Args...>;
+		std::unique_ptr<void, void (*)(void*)> guard(wrapper::create(std::forward<Fn>(fn)), wrapper::destroy);
+		RetType (*invoker)(Args..., void*) = wrapper::invoke_suffix;
+		function = reinterpret_cast<pointer>(pool::instance().acquire(guard.get(), reinterpret_cast<void (*)()>(invoker)));
+		userdata = guard.release();
+		destroy = wrapper::destroy;
+	}
+
+	closure(closure&& other) noexcept : function(other.function), userdata(other.userdata), destroy(other.destroy) {
+		other.function = nullptr;
+	}
+
+	closure& operator=(closure&& other) noexcept {
+		if (this != &other) {
+			reset();
+			function = other.function;
+			userdata = other.userdata;
+			destroy = other.destroy;
+			other.function = nullptr;
+		}
+		return *this;
+	}
+
+	~closure() {
+		reset();
+	}
+
+	/// Function pointer that invokes the wrapped functor.
+	pointer get() const {
+		return function;
+	}
+
+	/// Whether a functor is currently wrapped.
+	explicit operator bool() const {
+		return function != nullptr;
+	}
+
+	/// Destroy the wrapped functor and release its function pointer.
+	void reset() {
+		if (function) {
+			pool::instance().release(reinterpret_cast<void*>(function));
+			destroy(userdata);
+			function = nullptr;
+		}
+	}
+
+private:
+	pointer function = nullptr;
+	void *userdata = nullptr;
+	void (*destroy)(void*) = nullptr;
+};
+
+#endif
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto prefix_invoker_deleter(Fn&& fn) -> decltype(detail::deduced_function_wrapper<false, Fn>::prefix_invoker_deleter(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<false, Fn>::prefix_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto prefix_invoker_oneshot(Fn&& fn) -> decltype(detail::deduced_function_wrapper<true, Fn>::prefix_invoker(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<true, Fn>::prefix_invoker(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto prefix_invoker_unique(Fn&& fn) -> decltype(detail::deduced_function_wrapper<false, Fn>::prefix_invoker_unique(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<false, Fn>::prefix_invoker_unique(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto prefix_invoker_shared(Fn&& fn) -> decltype(detail::deduced_function_wrapper<false, Fn>::prefix_invoker_shared(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<false, Fn>::prefix_invoker_shared(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto suffix_invoker_deleter(Fn&& fn) -> decltype(detail::deduced_function_wrapper<false, Fn>::suffix_invoker_deleter(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<false, Fn>::suffix_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto suffix_invoker_oneshot(Fn&& fn) -> decltype(detail::deduced_function_wrapper<true, Fn>::suffix_invoker(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<true, Fn>::suffix_invoker(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto suffix_invoker_unique(Fn&& fn) -> decltype(detail::deduced_function_wrapper<false, Fn>::suffix_invoker_unique(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<false, Fn>::suffix_invoker_unique(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto suffix_invoker_shared(Fn&& fn) -> decltype(detail::deduced_function_wrapper<false, Fn>::suffix_invoker_shared(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<false, Fn>::suffix_invoker_shared(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Alloc, typename Fn>
+auto prefix_invoker_deleter(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) -> decltype(detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::prefix_invoker_deleter(std::forward<Fn>(fn), alloc)) {
+	return detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::prefix_invoker_deleter(std::forward<Fn>(fn), alloc);
+}
+
+/// Overload used for automatic type deduction
+template<typename Alloc, typename Fn>
+auto prefix_invoker_oneshot(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) -> decltype(detail::deduced_allocated_function_wrapper<true, Fn, Alloc>::prefix_invoker(std::forward<Fn>(fn), alloc)) {
+	return detail::deduced_allocated_function_wrapper<true, Fn, Alloc>::prefix_invoker(std::forward<Fn>(fn), alloc);
+}
+
+/// Overload used for automatic type deduction
+template<typename Alloc, typename Fn>
+auto prefix_invoker_unique(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) -> decltype(detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::prefix_invoker_unique(std::forward<Fn>(fn), alloc)) {
+	return detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::prefix_invoker_unique(std::forward<Fn>(fn), alloc);
+}
+
+/// Overload used for automatic type deduction
+template<typename Alloc, typename Fn>
+auto prefix_invoker_shared(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) -> decltype(detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::prefix_invoker_shared(std::forward<Fn>(fn), alloc)) {
+	return detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::prefix_invoker_shared(std::forward<Fn>(fn), alloc);
+}
+
+/// Overload used for automatic type deduction
+template<typename Alloc, typename Fn>
+auto suffix_invoker_deleter(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) -> decltype(detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::suffix_invoker_deleter(std::forward<Fn>(fn), alloc)) {
+	return detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::suffix_invoker_deleter(std::forward<Fn>(fn), alloc);
+}
+
+/// Overload used for automatic type deduction
+template<typename Alloc, typename Fn>
+auto suffix_invoker_oneshot(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) -> decltype(detail::deduced_allocated_function_wrapper<true, Fn, Alloc>::suffix_invoker(std::forward<Fn>(fn), alloc)) {
+	return detail::deduced_allocated_function_wrapper<true, Fn, Alloc>::suffix_invoker(std::forward<Fn>(fn), alloc);
+}
+
+/// Overload used for automatic type deduction
+template<typename Alloc, typename Fn>
+auto suffix_invoker_unique(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) -> decltype(detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::suffix_invoker_unique(std::forward<Fn>(fn), alloc)) {
+	return detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::suffix_invoker_unique(std::forward<Fn>(fn), alloc);
+}
+
+/// Overload used for automatic type deduction
+template<typename Alloc, typename Fn>
+auto suffix_invoker_shared(std::allocator_arg_t, const Alloc& alloc, Fn&& fn) -> decltype(detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::suffix_invoker_shared(std::forward<Fn>(fn), alloc)) {
+	return detail::deduced_allocated_function_wrapper<false, Fn, Alloc>::suffix_invoker_shared(std::forward<Fn>(fn), alloc);
+}
 
-namespace functor2c {
+/// Overload used for automatic type deduction
+template<typename Policy, typename Fn>
+auto prefix_invoker_refcounted(Policy, Fn&& fn) -> decltype(detail::deduced_refcounted_function_wrapper<Policy, Fn>::prefix_invoker_refcounted(std::forward<Fn>(fn))) {
+	return detail::deduced_refcounted_function_wrapper<Policy, Fn>::prefix_invoker_refcounted(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto prefix_invoker_refcounted(Fn&& fn) -> decltype(detail::deduced_refcounted_function_wrapper<atomic_refcount, Fn>::prefix_invoker_refcounted(std::forward<Fn>(fn))) {
+	return detail::deduced_refcounted_function_wrapper<atomic_refcount, Fn>::prefix_invoker_refcounted(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Policy, typename Fn>
+auto suffix_invoker_refcounted(Policy, Fn&& fn) -> decltype(detail::deduced_refcounted_function_wrapper<Policy, Fn>::suffix_invoker_refcounted(std::forward<Fn>(fn))) {
+	return detail::deduced_refcounted_function_wrapper<Policy, Fn>::suffix_invoker_refcounted(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto suffix_invoker_refcounted(Fn&& fn) -> decltype(detail::deduced_refcounted_function_wrapper<atomic_refcount, Fn>::suffix_invoker_refcounted(std::forward<Fn>(fn))) {
+	return detail::deduced_refcounted_function_wrapper<atomic_refcount, Fn>::suffix_invoker_refcounted(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto prefix_invoker_vtable(Fn&& fn) -> decltype(detail::deduced_function_wrapper<false, Fn>::prefix_invoker_vtable(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<false, Fn>::prefix_invoker_vtable(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto suffix_invoker_vtable(Fn&& fn) -> decltype(detail::deduced_function_wrapper<false, Fn>::suffix_invoker_vtable(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<false, Fn>::suffix_invoker_vtable(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto prefix_invoker_ref(Fn& fn) -> decltype(detail::deduced_function_ref<Fn>::prefix_invoker(fn)) {
+	return detail::deduced_function_ref<Fn>::prefix_invoker(fn);
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto suffix_invoker_ref(Fn& fn) -> decltype(detail::deduced_function_ref<Fn>::suffix_invoker(fn)) {
+	return detail::deduced_function_ref<Fn>::suffix_invoker(fn);
+}
+
+
+
+#ifdef FUNCTOR2C_ASYNC
+/// Overload used for automatic type deduction
+template<typename Executor, typename Fn>
+auto prefix_invoker_async(Executor& executor, Fn&& fn, const async_options& options = async_options()) -> decltype(detail::deduced_async_function<Fn, Executor>::prefix_invoker(executor, std::forward<Fn>(fn), options)) {
+	static_assert(std::is_void<typename detail::deduced_signature<Fn>::return_type>::value, "Asynchronous invokers cannot return values");
+	return detail::deduced_async_function<Fn, Executor>::prefix_invoker(executor, std::forward<Fn>(fn), options);
+}
+
+/// Overload used for automatic type deduction
+template<typename Executor, typename Fn>
+auto suffix_invoker_async(Executor& executor, Fn&& fn, const async_options& options = async_options()) -> decltype(detail::deduced_async_function<Fn, Executor>::suffix_invoker(executor, std::forward<Fn>(fn), options)) {
+	static_assert(std::is_void<typename detail::deduced_signature<Fn>::return_type>::value, "Asynchronous invokers cannot return values");
+	return detail::deduced_async_function<Fn, Executor>::suffix_invoker(executor, std::forward<Fn>(fn), options);
+}
+#endif
+
+/// Overload used for automatic type deduction
+template<typename Range>
+auto make_many(Range&& range) -> decltype(detail::deduced_many_function<Range>::prefix_invoker(std::forward<Range>(range))) {
+	return detail::deduced_many_function<Range>::prefix_invoker(std::forward<Range>(range));
+}
+
+/// Overload used for automatic type deduction
+template<typename Range>
+auto make_many_suffix(Range&& range) -> decltype(detail::deduced_many_function<Range>::suffix_invoker(std::forward<Range>(range))) {
+	return detail::deduced_many_function<Range>::suffix_invoker(std::forward<Range>(range));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto prefix_invoker_batch(Fn&& fn) -> decltype(detail::deduced_function_wrapper<false, Fn>::prefix_invoker_batch(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<false, Fn>::prefix_invoker_batch(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto suffix_invoker_batch(Fn&& fn) -> decltype(detail::deduced_function_wrapper<false, Fn>::suffix_invoker_batch(std::forward<Fn>(fn))) {
+	return detail::deduced_function_wrapper<false, Fn>::suffix_invoker_batch(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto prefix_invoker_deleter(realtime, Fn&& fn) -> decltype(detail::deduced_realtime_function<Fn>::prefix_invoker_deleter(std::forward<Fn>(fn))) {
+	return detail::deduced_realtime_function<Fn>::prefix_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto prefix_invoker_unique(realtime, Fn&& fn) -> decltype(detail::deduced_realtime_function<Fn>::prefix_invoker_unique(std::forward<Fn>(fn))) {
+	return detail::deduced_realtime_function<Fn>::prefix_invoker_unique(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto suffix_invoker_deleter(realtime, Fn&& fn) -> decltype(detail::deduced_realtime_function<Fn>::suffix_invoker_deleter(std::forward<Fn>(fn))) {
+	return detail::deduced_realtime_function<Fn>::suffix_invoker_deleter(std::forward<Fn>(fn));
+}
+
+/// Overload used for automatic type deduction
+template<typename Fn>
+auto suffix_invoker_unique(realtime, Fn&& fn) -> decltype(detail::deduced_realtime_function<Fn>::suffix_invoker_unique(std::forward<Fn>(fn))) {
+	return detail::deduced_realtime_function<Fn>::suffix_invoker_unique(std::forward<Fn>(fn));
+}
+
+#if __cplusplus >= 201703L
 
 namespace detail {
 
 /**
- * Wrapper for `std::function` with helper methods to get invoker/deleter function pointers.
+ * Static trampolines for the compile-time `Function`, which receives `Object*` as its first argument.
  * @private
  */
-template<bool destroy_on_invoke, typename RetType, typename... Args>
-struct destroyable_function {
-	/**
-	 * Deleter used to wrap destroyable function in `std::unique_ptr`.
-	 * @private
-	 */
-	struct deleter {
-		void operator()(void *userdata) const {
-			destroy(userdata);
-		}
-	};
-
-	template<typename Fn>
-	destroyable_function(Fn&& fn) : function(std::move(fn)) {}
+template<auto Function, typename Object, typename RetType, typename... Args>
+struct bound_function {
+	using object_type = Object;
 
-	RetType operator()(Args... args) {
-		std::unique_ptr<destroyable_function> destroyer;
-		if (destroy_on_invoke) {
-			destroyer = std::unique_ptr<destroyable_function>(this);
-		}
-		return function(std::forward<Args>(args)...);
+	static RetType invoke_prefix(void *userdata, Args... args) {
+		return std::invoke(Function, static_cast<Object*>(userdata), std::forward<Args>(args)...);
 	}
 
-	std::tuple<void*, RetType (*)(void*, Args...)> prefix_invoker() {
-		return std::make_tuple(static_cast<void*>(this), invoke_prefix);
-	}
-	std::tuple<void*, RetType (*)(void*, Args...), void (*)(void*)> prefix_invoker_deleter() {
-		return std::make_tuple(static_cast<void*>(this), invoke_prefix, destroy);
-	}
-	std::tuple<std::unique_ptr<void, deleter>, RetType (*)(void*, Args...)> prefix_invoker_unique() {
-		return std::make_tuple(std::unique_ptr<void, deleter>(static_cast<void*>(this)), invoke_prefix);
-	}
-	std::tuple<std::shared_ptr<void>, RetType (*)(void*, Args...)> prefix_invoker_shared() {
-		return std::make_tuple(std::shared_ptr<void>(static_cast<void*>(this), destroy), invoke_prefix);
+	static RetType invoke_suffix(Args... args, void *userdata) {
+		return std::invoke(Function, static_cast<Object*>(userdata), std::forward<Args>(args)...);
 	}
+};
 
-	std::tuple<RetType (*)(Args..., void*), void*> suffix_invoker() {
-		return std::make_tuple(invoke_suffix, static_cast<void*>(this));
-	}
-	std::tuple<RetType (*)(Args..., void*), void*, void (*)(void*)> suffix_invoker_deleter() {
-		return std::make_tuple(invoke_suffix, static_cast<void*>(this), destroy);
-	}
-	std::tuple<RetType (*)(Args..., void*), std::unique_ptr<void, deleter>> suffix_invoker_unique() {
-		return std::make_tuple(invoke_suffix, std::unique_ptr<void, deleter>(static_cast<void*>(this)));
-	}
-	std::tuple<RetType (*)(Args..., void*), std::shared_ptr<void>> suffix_invoker_shared() {
-		return std::make_tuple(invoke_suffix, std::shared_ptr<void>(static_cast<void*>(this), destroy));
+/**
+ * Static trampolines for the compile-time free `Function` that takes no object pointer, ignoring the userdata.
+ * @private
+ */
+template<auto Function, typename RetType, typename... Args>
+struct unbound_function {
+	static RetType invoke_prefix(void *, Args... args) {
+		return Function(std::forward<Args>(args)...);
 	}
 
-	static RetType invoke_prefix(void *userdata, Args... args) {
-		auto self = static_cast<destroyable_function*>(userdata);
-		return (*self)(std::forward<Args>(args)...);
+	static RetType invoke_suffix(Args... args, void *) {
+		return Function(std::forward<Args>(args)...);
 	}
+};
 
-	static RetType invoke_suffix(Args... args, void *userdata) {
-		auto self = static_cast<destroyable_function*>(userdata);
-		return (*self)(std::forward<Args>(args)...);
-	}
+/**
+ * Extracts object type, return type and arguments from member function pointers and
+ * free function pointers whose first parameter is the object pointer.
+ * Other free function pointers get trampolines that ignore the userdata.
+ * @private
+ */
+template<typename FunctionType>
+struct bound_function_traits {
+	static_assert(sizeof(FunctionType) == 0, "Trampolines require a pointer to a member function or a free function");
+};
 
-	static void destroy(void *userdata) {
-		auto self = static_cast<destroyable_function*>(userdata);
-		delete self;
-	}
+template<typename RetType, typename... Args>
+struct bound_function_traits<RetType (*)(Args...)> {
+	template<auto Function>
+	using type = unbound_function<Function, RetType, Args...>;
+};
+template<typename RetType, typename... Args>
+struct bound_function_traits<RetType (*)(Args...) noexcept> : bound_function_traits<RetType (*)(Args...)> {};
 
-private:
-	std::function<RetType(Args...)> function;
+template<typename Object, typename RetType, typename... Args>
+struct bound_function_traits<RetType (*)(Object*, Args...)> {
+	template<auto Function>
+	using type = bound_function<Function, Object, RetType, Args...>;
+};
+template<typename Object, typename RetType, typename... Args>
+struct bound_function_traits<RetType (*)(Object*, Args...) noexcept> : bound_function_traits<RetType (*)(Object*, Args...)> {};
+
+template<typename Class, typename RetType, typename... Args>
+struct bound_function_traits<RetType (Class::*)(Args...)> {
+	template<auto Function>
+	using type = bound_function<Function, Class, RetType, Args...>;
+};
+template<typename Class, typename RetType, typename... Args>
+struct bound_function_traits<RetType (Class::*)(Args...) noexcept> : bound_function_traits<RetType (Class::*)(Args...)> {};
+
+template<typename Class, typename RetType, typename... Args>
+struct bound_function_traits<RetType (Class::*)(Args...) const> {
+	template<auto Function>
+	using type = bound_function<Function, const Class, RetType, Args...>;
 };
+template<typename Class, typename RetType, typename... Args>
+struct bound_function_traits<RetType (Class::*)(Args...) const noexcept> : bound_function_traits<RetType (Class::*)(Args...) const> {};
+
+template<auto Function>
+using bound_function_for = typename bound_function_traits<decltype(Function)>::template type<Function>;
 
 }
 
 /**
- * Transform `fn` into a [userdata, invoker, deleter] tuple.
- *
- * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ * Static invoker for the compile-time `Function`, accepting the object pointer as `userdata` prefix argument.
  *
- * @note You are responsible for calling the deleter with the userdata as parameter to reclaim allocated memory.
+ * `Function` may be a member function pointer or a free function pointer whose first parameter is the object pointer.
+ * Free functions without an object pointer parameter are supported as well, ignoring the userdata.
+ * No memory is allocated and the call to `Function` can be fully inlined.
  *
  * @code
- * auto [userdata, invoker, deleter] = prefix_invoker_deleter([](int value) {});
- * // Invoke wrapped function as many times as you need.
- * invoker(userdata, 1);
- * invoker(userdata, 2);
- * invoker(userdata, 3);
- * // Delete wrapped function afterwards to avoid memory leak.
- * deleter(userdata);
+ * struct Connection {
+ *     void on_event(int event);
+ * };
+ * auto invoker = prefix_trampoline<&Connection::on_event>;
+ * invoker(&connection, 42);
  * @endcode
- *
- * @return Tuple containing an opaque userdata, plus its invoker and deleter functions.
  */
-template<typename RetType, typename... Args, typename Fn>
-std::tuple<void*, RetType (*)(void*, Args...), void (*)(void*)> prefix_invoker_deleter(Fn&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->prefix_invoker_deleter();
-}
+template<auto Function>
+constexpr auto prefix_trampoline = &detail::bound_function_for<Function>::invoke_prefix;
 
 /**
- * Transform `fn` into a [userdata, oneshot_invoker] tuple.
- *
- * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
- * The allocated memory will be freed in the first invocation, so you must invoke it exactly once.
- *
- * @warning If you don't invoke the function, memory will leak.
- * @warning If you try to invoke the function twice, your app will try to access freed memory and likely SEGFAULT.
+ * Same as `prefix_trampoline` where the invoker accepts userdata parameter suffix instead of prefix.
  *
  * @code
- * auto [userdata, oneshot_invoker] = prefix_invoker_oneshot([](int value) {});
- * // Invoke wrapped function exactly once
- * oneshot_invoker(userdata, 42);
+ * auto invoker = suffix_trampoline<&Connection::on_event>;
+ * invoker(42, &connection);
  * @endcode
- *
- * @return Tuple containing an opaque userdata, plus its oneshot invoker function.
  */
-template<typename RetType, typename... Args, typename Fn>
-std::tuple<void*, RetType (*)(void*, Args...)> prefix_invoker_oneshot(Fn&& fn) {
-	return (new detail::destroyable_function<true, RetType, Args...>(std::move(fn)))->prefix_invoker();
-}
+template<auto Function>
+constexpr auto suffix_trampoline = &detail::bound_function_for<Function>::invoke_suffix;
 
 /**
- * Transform `fn` into a [userdata, invoker] tuple.
+ * Bind `object` to the compile-time `Function`, returning a [userdata, invoker] tuple.
  *
- * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
+ * The object pointer itself is used as userdata, so there's nothing to delete.
  *
- * @note The userdata is owned by a `std::unique_ptr`, so there's no need to manually delete it.
+ * @warning `object` must outlive any invocations.
  *
  * @code
- * auto [userdata, invoker] = prefix_invoker_unique([](int value) {});
- * // Invoke wrapped function as many times as you need.
- * invoker(userdata.get(), 1);
- * invoker(userdata.get(), 2);
- * invoker(userdata.get(), 3);
- * // Userdata is a unique_ptr, memory will be freed automatically.
+ * auto [userdata, invoker] = prefix_bind<&Connection::on_event>(this);
+ * invoker(userdata, 42);
  * @endcode
  *
- * @return Tuple containing an opaque userdata, plus its invoker and deleter functions.
+ * @return Tuple containing the object pointer as opaque userdata, plus its invoker function.
  */
-template<typename RetType, typename... Args, typename Fn>
-std::tuple<std::unique_ptr<void, typename detail::destroyable_function<false, RetType, Args...>::deleter>, RetType (*)(void*, Args...)> prefix_invoker_unique(Fn&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->prefix_invoker_unique();
+template<auto Function>
+auto prefix_bind(typename detail::bound_function_for<Function>::object_type *object) {
+	return std::make_tuple(const_cast<void*>(static_cast<const void*>(object)), prefix_trampoline<Function>);
 }
 
 /**
- * Transform `fn` into a [userdata, invoker] tuple.
- *
- * The invoker accepts the same parameters as `fn`, with the addition of the `userdata` prefix argument.
- *
- * @note The userdata is retained by a `std::shared_ptr`, so there's no need to manually delete it.
+ * Same as `prefix_bind` where the invoker accepts userdata parameter suffix instead of prefix.
  *
  * @code
- * auto [userdata, invoker] = prefix_invoker_shared([](int value) {});
- * // Invoke wrapped function as many times as you need.
- * invoker(userdata.get(), 1);
- * invoker(userdata.get(), 2);
- * invoker(userdata.get(), 3);
- * // Userdata is a shared_ptr, memory will be freed automatically.
+ * auto [invoker, userdata] = suffix_bind<&Connection::on_event>(this);
+ * invoker(42, userdata);
  * @endcode
- *
- * @return Tuple containing an opaque userdata, plus its invoker and deleter functions.
  */
-template<typename RetType, typename... Args, typename Fn>
-std::tuple<std::shared_ptr<void>, RetType (*)(void*, Args...)> prefix_invoker_shared(Fn&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->prefix_invoker_shared();
+template<auto Function>
+auto suffix_bind(typename detail::bound_function_for<Function>::object_type *object) {
+	return std::make_tuple(suffix_trampoline<Function>, const_cast<void*>(static_cast<const void*>(object)));
 }
 
+#endif
 
-/**
- * Same as `prefix_invoker_deleter` where the invoker accepts userdata parameter suffix instead of prefix.
- *
- * @code
- * auto [userdata, invoker, deleter] = suffix_invoker_deleter([](int value) {});
- * // Invoke wrapped function as many times as you need.
- * invoker(1, userdata);
- * invoker(2, userdata);
- * invoker(3, userdata);
- * // Delete wrapped function afterwards to avoid memory leak.
- * deleter(userdata);
- * @endcode
- */
-template<typename RetType, typename... Args, typename Fn>
-std::tuple<void*, RetType (*)(Args..., void*), void (*)(void*)> suffix_invoker_deleter(Fn&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->suffix_invoker_deleter();
 }
 
+#if defined(FUNCTOR2C_REALTIME_ALLOCATION_TRAP) && defined(FUNCTOR2C_REALTIME_ALLOCATION_TRAP_IMPLEMENTATION)
+
+#include <cstdlib>
+
+#ifndef FUNCTOR2C_REALTIME_TRAP
+	#define FUNCTOR2C_REALTIME_TRAP() std::abort()
+#endif
+
+namespace functor2c {
+namespace detail {
+
 /**
- * Same as `prefix_invoker_oneshot` where the invoker accepts userdata parameter suffix instead of prefix.
- *
- * @code
- * auto [userdata, oneshot_invoker] = suffix_invoker_oneshot([](int value) {});
- * // Invoke wrapped function exactly once
- * oneshot_invoker(42, userdata);
- * @endcode
+ * Allocation used by every replaced `operator new`, trapping inside realtime invokers.
+ * @private
  */
-template<typename RetType, typename... Args, typename Fn>
-std::tuple<void*, RetType (*)(Args..., void*)> suffix_invoker_oneshot(Fn&& fn) {
-	return (new detail::destroyable_function<true, RetType, Args...>(std::move(fn)))->suffix_invoker();
+inline void *realtime_allocate(std::size_t size, std::size_t alignment) noexcept {
+	if (functor2c::in_realtime_invoker()) {
+		FUNCTOR2C_REALTIME_TRAP();
+	}
+	if (size == 0) {
+		size = 1;
+	}
+#ifdef __cpp_aligned_new
+	if (alignment > alignof(std::max_align_t)) {
+		return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+	}
+#else
+	(void) alignment;
+#endif
+	return std::malloc(size);
 }
 
 /**
- * Same as `prefix_invoker_unique` where the invoker accepts userdata parameter suffix instead of prefix.
- *
- * @code
- * auto [userdata, invoker] = suffix_invoker_unique([](int value) {});
- * // Invoke wrapped function as many times as you need.
- * invoker(1, userdata.get());
- * invoker(2, userdata.get());
- * invoker(3, userdata.get());
- * // Userdata is a unique_ptr, memory will be freed automatically.
- * @endcode
+ * Same as `realtime_allocate`, throwing `std::bad_alloc` on failure.
+ * @private
  */
-template<typename RetType, typename... Args, typename Fn>
-std::tuple<std::unique_ptr<void, typename detail::destroyable_function<false, RetType, Args...>::deleter>, RetType (*)(Args..., void*)> suffix_invoker_unique(Fn&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->suffix_invoker_unique();
+inline void *realtime_allocate_or_throw(std::size_t size, std::size_t alignment) {
+	if (void *pointer = realtime_allocate(size, alignment)) {
+		return pointer;
+	}
+	throw std::bad_alloc();
 }
 
 /**
- * Same as `prefix_invoker_shared` where the invoker accepts userdata parameter suffix instead of prefix.
- *
- * @code
- * auto [userdata, invoker] = suffix_invoker_shared([](int value) {});
- * // Invoke wrapped function as many times as you need.
- * invoker(1, userdata.get());
- * invoker(2, userdata.get());
- * invoker(3, userdata.get());
- * // Userdata is a shared_ptr, memory will be freed automatically.
- * @endcode
+ * Deallocation used by every replaced `operator delete`, trapping inside realtime invokers.
+ * @private
  */
-template<typename RetType, typename... Args, typename Fn>
-std::tuple<std::shared_ptr<void>, RetType (*)(Args..., void*)> suffix_invoker_shared(Fn&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->suffix_invoker_shared();
+inline void realtime_free(void *pointer) noexcept {
+	if (pointer && functor2c::in_realtime_invoker()) {
+		FUNCTOR2C_REALTIME_TRAP();
+	}
+	std::free(pointer);
 }
 
+}
+}
 
-#if __cplusplus >= 201703L
+void *operator new(std::size_t size) {
+	return functor2c::detail::realtime_allocate_or_throw(size, alignof(std::max_align_t));
+}
 
-/// Overload used for automatic type deduction in C++17
-template<typename RetType, typename... Args>
-auto prefix_invoker_deleter(std::function<RetType(Args...)>&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->prefix_invoker_deleter();
+void *operator new[](std::size_t size) {
+	return functor2c::detail::realtime_allocate_or_throw(size, alignof(std::max_align_t));
 }
-/// Overload used for automatic type deduction in C++17
-template<typename Fn>
-auto prefix_invoker_deleter(Fn&& fn) {
-	return prefix_invoker_deleter(std::move(std::function(fn)));
+
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return functor2c::detail::realtime_allocate(size, alignof(std::max_align_t));
 }
 
-/// Overload used for automatic type deduction in C++17
-template<typename RetType, typename... Args>
-auto prefix_invoker_oneshot(std::function<RetType(Args...)>&& fn) {
-	return (new detail::destroyable_function<true, RetType, Args...>(std::move(fn)))->prefix_invoker();
+void *operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return functor2c::detail::realtime_allocate(size, alignof(std::max_align_t));
 }
-/// Overload used for automatic type deduction in C++17
-template<typename Fn>
-auto prefix_invoker_oneshot(Fn&& fn) {
-	return prefix_invoker_oneshot(std::move(std::function(fn)));
+
+void operator delete(void *pointer) noexcept {
+	functor2c::detail::realtime_free(pointer);
 }
 
-/// Overload used for automatic type deduction in C++17
-template<typename RetType, typename... Args>
-auto prefix_invoker_unique(std::function<RetType(Args...)>&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->prefix_invoker_unique();
+void operator delete[](void *pointer) noexcept {
+	functor2c::detail::realtime_free(pointer);
 }
-/// Overload used for automatic type deduction in C++17
-template<typename Fn>
-auto prefix_invoker_unique(Fn&& fn) {
-	return prefix_invoker_unique(std::move(std::function(fn)));
+
+void operator delete(void *pointer, const std::nothrow_t&) noexcept {
+	functor2c::detail::realtime_free(pointer);
 }
 
-/// Overload used for automatic type deduction in C++17
-template<typename RetType, typename... Args>
-auto prefix_invoker_shared(std::function<RetType(Args...)>&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->prefix_invoker_shared();
+void operator delete[](void *pointer, const std::nothrow_t&) noexcept {
+	functor2c::detail::realtime_free(pointer);
 }
-/// Overload used for automatic type deduction in C++17
-template<typename Fn>
-auto prefix_invoker_shared(Fn&& fn) {
-	return prefix_invoker_shared(std::move(std::function(fn)));
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *pointer, std::size_t) noexcept {
+	functor2c::detail::realtime_free(pointer);
 }
 
-/// Overload used for automatic type deduction in C++17
-template<typename RetType, typename... Args>
-auto suffix_invoker_deleter(std::function<RetType(Args...)>&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->suffix_invoker_deleter();
+void operator delete[](void *pointer, std::size_t) noexcept {
+	functor2c::detail::realtime_free(pointer);
 }
-/// Overload used for automatic type deduction in C++17
-template<typename Fn>
-auto suffix_invoker_deleter(Fn&& fn) {
-	return suffix_invoker_deleter(std::move(std::function(fn)));
+#endif
+
+#ifdef __cpp_aligned_new
+void *operator new(std::size_t size, std::align_val_t alignment) {
+	return functor2c::detail::realtime_allocate_or_throw(size, static_cast<std::size_t>(alignment));
 }
 
-/// Overload used for automatic type deduction in C++17
-template<typename RetType, typename... Args>
-auto suffix_invoker_oneshot(std::function<RetType(Args...)>&& fn) {
-	return (new detail::destroyable_function<true, RetType, Args...>(std::move(fn)))->suffix_invoker();
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+	return functor2c::detail::realtime_allocate_or_throw(size, static_cast<std::size_t>(alignment));
 }
-/// Overload used for automatic type deduction in C++17
-template<typename Fn>
-auto suffix_invoker_oneshot(Fn&& fn) {
-	return suffix_invoker_oneshot(std::move(std::function(fn)));
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return functor2c::detail::realtime_allocate(size, static_cast<std::size_t>(alignment));
 }
 
-/// Overload used for automatic type deduction in C++17
-template<typename RetType, typename... Args>
-auto suffix_invoker_unique(std::function<RetType(Args...)>&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->suffix_invoker_unique();
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return functor2c::detail::realtime_allocate(size, static_cast<std::size_t>(alignment));
 }
-/// Overload used for automatic type deduction in C++17
-template<typename Fn>
-auto suffix_invoker_unique(Fn&& fn) {
-	return suffix_invoker_unique(std::move(std::function(fn)));
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+	functor2c::detail::realtime_free(pointer);
 }
 
-/// Overload used for automatic type deduction in C++17
-template<typename RetType, typename... Args>
-auto suffix_invoker_shared(std::function<RetType(Args...)>&& fn) {
-	return (new detail::destroyable_function<false, RetType, Args...>(std::move(fn)))->suffix_invoker_shared();
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+	functor2c::detail::realtime_free(pointer);
 }
-/// Overload used for automatic type deduction in C++17
-template<typename Fn>
-auto suffix_invoker_shared(Fn&& fn) {
-	return prefix_invoker_shared(std::move(std::function(fn)));
+
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+	functor2c::detail::realtime_free(pointer);
 }
 
-#endif
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+	functor2c::detail::realtime_free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+	functor2c::detail::realtime_free(pointer);
+}
 
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+	functor2c::detail::realtime_free(pointer);
 }
+#endif
+
+#endif
 
 #endif  // __FUNCTOR2C_HPP__
@@ -1,6 +1,23 @@
 #include <catch2/catch_test_macros.hpp>
+
+// Count allocations made inside realtime invokers instead of aborting
+static int realtime_allocations = 0;
+#define FUNCTOR2C_REALTIME_ALLOCATION_TRAP
+#define FUNCTOR2C_REALTIME_ALLOCATION_TRAP_IMPLEMENTATION
+#define FUNCTOR2C_REALTIME_TRAP() (realtime_allocations++)
+#define FUNCTOR2C_ASYNC
+#define FUNCTOR2C_CLOSURE
 #include "../functor2c.hpp"
 
+#include <algorithm>
+#include <array>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
 TEST_CASE("Test") {
 	auto [userdata, invoker, deleter] = functor2c::prefix_invoker_deleter([](int a) {
 		REQUIRE(true);
@@ -62,3 +79,1060 @@ TEST_CASE("Test Shared <void>") {
 
 	invoker(userdata.get());
 }
+
+TEST_CASE("Test Suffix Shared") {
+	int calls = 0;
+	auto [invoker, userdata] = functor2c::suffix_invoker_shared([&calls](int value) {
+		calls += value;
+	});
+
+	invoker(1, userdata.get());
+	invoker(2, userdata.get());
+	REQUIRE(calls == 3);
+}
+
+TEST_CASE("Test stores concrete functor") {
+	struct counter {
+		int *calls;
+		int operator()(int value) const {
+			return *calls += value;
+		}
+	};
+	int calls = 0;
+	auto [userdata, invoker, deleter] = functor2c::prefix_invoker_deleter<int, int>(counter { &calls });
+	static_assert(sizeof(functor2c::detail::destroyable_function<false, counter, std::allocator<char>, int, int>) == sizeof(counter));
+
+	REQUIRE(invoker(userdata, 2) == 2);
+	REQUIRE(invoker(userdata, 3) == 5);
+	deleter(userdata);
+}
+
+TEST_CASE("Test empty functors need no userdata") {
+	struct stateless {
+		int operator()(int value) const {
+			return value * 2;
+		}
+	};
+
+	auto [userdata, invoker, deleter] = functor2c::prefix_invoker_deleter<int, int>(stateless {});
+	REQUIRE(userdata == nullptr);
+	REQUIRE(invoker(userdata, 21) == 42);
+	deleter(userdata);
+
+	auto [oneshot_invoker, oneshot_userdata] = functor2c::suffix_invoker_oneshot([](int value) { return value + 1; });
+	REQUIRE(oneshot_userdata == nullptr);
+	REQUIRE(oneshot_invoker(41, oneshot_userdata) == 42);
+
+	auto [unique_userdata, unique_invoker] = functor2c::prefix_invoker_unique([]() { return 42; });
+	REQUIRE(unique_userdata.get() == nullptr);
+	REQUIRE(unique_invoker(unique_userdata.get()) == 42);
+
+	auto [shared_invoker, shared_userdata] = functor2c::suffix_invoker_shared([]() { return 42; });
+	REQUIRE(shared_userdata.get() == nullptr);
+	REQUIRE(shared_userdata.use_count() == 0);
+	REQUIRE(shared_invoker(shared_userdata.get()) == 42);
+}
+
+TEST_CASE("Test small functors are packed in userdata") {
+	int value = 0;
+	auto [userdata, invoker] = functor2c::prefix_invoker_unique([&value](int new_value) {
+		value = new_value;
+	});
+	REQUIRE(userdata.get() == static_cast<void*>(&value));
+	invoker(userdata.get(), 42);
+	REQUIRE(value == 42);
+
+	int (*function_pointer)(int) = [](int a) { return a * 2; };
+	auto [fptr_invoker, fptr_userdata, fptr_deleter] = functor2c::suffix_invoker_deleter(function_pointer);
+	REQUIRE(fptr_userdata == reinterpret_cast<void*>(function_pointer));
+	REQUIRE(fptr_invoker(21, fptr_userdata) == 42);
+	fptr_deleter(fptr_userdata);
+
+	auto [shared_userdata, shared_invoker] = functor2c::prefix_invoker_shared([&value]() { return value; });
+	REQUIRE(shared_userdata.use_count() == 0);
+	REQUIRE(shared_invoker(shared_userdata.get()) == 42);
+}
+
+namespace {
+struct mutable_counter {
+	mutable int count = 0;
+
+	int operator()() const {
+		return ++count;
+	}
+};
+
+struct packable_adder {
+	std::intptr_t value;
+
+	int operator()(int a) const {
+		return int(value) + a;
+	}
+};
+}
+
+template<>
+struct functor2c::is_packable<packable_adder> : std::true_type {};
+
+TEST_CASE("Test mutable functors keep their state") {
+	auto [userdata, invoker] = functor2c::prefix_invoker_unique([count = 0]() mutable {
+		return ++count;
+	});
+	REQUIRE(userdata.get() != nullptr);
+	REQUIRE(invoker(userdata.get()) == 1);
+	REQUIRE(invoker(userdata.get()) == 2);
+
+	// Small functors with mutable members are not packed, even if invocable as const
+	auto [counter_userdata, counter_invoker, counter_deleter] = functor2c::prefix_invoker_deleter(mutable_counter{});
+	REQUIRE(counter_invoker(counter_userdata) == 1);
+	REQUIRE(counter_invoker(counter_userdata) == 2);
+	REQUIRE(counter_invoker(counter_userdata) == 3);
+	counter_deleter(counter_userdata);
+
+	// Unless they are known to have none
+	auto [packed_userdata, packed_invoker, packed_deleter] = functor2c::prefix_invoker_deleter(packable_adder { 40 });
+	REQUIRE(packed_userdata == reinterpret_cast<void*>(std::intptr_t(40)));
+	REQUIRE(packed_invoker(packed_userdata, 2) == 42);
+	packed_deleter(packed_userdata);
+}
+
+namespace {
+struct bind_target {
+	int value = 0;
+
+	void set(int new_value) {
+		value = new_value;
+	}
+	int get() const noexcept {
+		return value;
+	}
+};
+
+int add_to_target(bind_target *target, int amount) {
+	return target->value += amount;
+}
+
+int negate(int value) noexcept {
+	return -value;
+}
+}
+
+TEST_CASE("Test bind") {
+	bind_target target;
+
+	auto [userdata, set_invoker] = functor2c::prefix_bind<&bind_target::set>(&target);
+	REQUIRE(userdata == &target);
+	set_invoker(userdata, 40);
+	REQUIRE(target.value == 40);
+
+	auto [add_invoker, suffix_userdata] = functor2c::suffix_bind<&add_to_target>(&target);
+	REQUIRE(add_invoker(2, suffix_userdata) == 42);
+
+	const bind_target& const_target = target;
+	auto [const_userdata, get_invoker] = functor2c::prefix_bind<&bind_target::get>(&const_target);
+	REQUIRE(get_invoker(const_userdata) == 42);
+
+	int (*get_trampoline)(void*) = functor2c::prefix_trampoline<&bind_target::get>;
+	REQUIRE(get_trampoline(&target) == 42);
+
+	// Free functions without an object pointer ignore the userdata
+	int (*negate_trampoline)(void*, int) = functor2c::prefix_trampoline<&negate>;
+	REQUIRE(negate_trampoline(nullptr, 42) == -42);
+	int (*suffix_negate_trampoline)(int, void*) = functor2c::suffix_trampoline<&negate>;
+	REQUIRE(suffix_negate_trampoline(42, &target) == -42);
+}
+
+TEST_CASE("Test Ref") {
+	int sum = 0;
+	auto accumulate = [&sum](int value) {
+		sum += value;
+	};
+
+	auto [userdata, invoker] = functor2c::prefix_invoker_ref(accumulate);
+	REQUIRE(userdata == &accumulate);
+	invoker(userdata, 1);
+	invoker(userdata, 2);
+
+	auto [suffix_invoker, suffix_userdata] = functor2c::suffix_invoker_ref<void, int>(accumulate);
+	suffix_invoker(3, suffix_userdata);
+	REQUIRE(sum == 6);
+}
+
+TEST_CASE("Test inline_invoker") {
+	struct counted {
+		int *destroyed;
+		int value;
+		int operator()(int a) const {
+			return a + value;
+		}
+		~counted() {
+			++*destroyed;
+		}
+	};
+	int destroyed = 0;
+	{
+		functor2c::inline_invoker<int(int), sizeof(counted)> storage;
+		REQUIRE_FALSE(storage);
+
+		auto [userdata, invoker] = storage.prefix_invoker(counted { &destroyed, 40 });
+		REQUIRE(storage);
+		REQUIRE(userdata == static_cast<void*>(&storage));
+		REQUIRE(invoker(userdata, 2) == 42);
+
+		destroyed = 0;
+		auto [suffix_invoker, suffix_userdata] = storage.suffix_invoker(counted { &destroyed, 1 });
+		REQUIRE(destroyed == 2);  // previous stored functor + moved from temporary
+		REQUIRE(suffix_invoker(1, suffix_userdata) == 2);
+	}
+	REQUIRE(destroyed == 3);
+}
+
+namespace {
+template<typename T>
+struct counting_allocator {
+	using value_type = T;
+
+	int *allocations;
+
+	counting_allocator(int *allocations) : allocations(allocations) {}
+	template<typename U>
+	counting_allocator(const counting_allocator<U>& other) : allocations(other.allocations) {}
+
+	T *allocate(std::size_t n) {
+		++*allocations;
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T *pointer, std::size_t n) {
+		--*allocations;
+		std::allocator<T>().deallocate(pointer, n);
+	}
+};
+}
+
+TEST_CASE("Test allocators") {
+	std::array<int, 16> state {};
+	int allocations = 0;
+	counting_allocator<char> allocator(&allocations);
+
+	auto [userdata, invoker, deleter] = functor2c::prefix_invoker_deleter(std::allocator_arg, allocator, [state](int i) { return state[i]; });
+	REQUIRE(allocations == 1);
+	REQUIRE(invoker(userdata, 0) == 0);
+	deleter(userdata);
+	REQUIRE(allocations == 0);
+
+	auto [oneshot_invoker, oneshot_userdata] = functor2c::suffix_invoker_oneshot<int, int>(std::allocator_arg, allocator, [state](int i) { return state[i]; });
+	REQUIRE(allocations == 1);
+	REQUIRE(oneshot_invoker(1, oneshot_userdata) == 0);
+	REQUIRE(allocations == 0);
+
+	{
+		auto [shared_userdata, shared_invoker] = functor2c::prefix_invoker_shared(std::allocator_arg, allocator, [state]() { return state.size(); });
+		REQUIRE(allocations == 1);  // wrapper and shared_ptr control block share a single allocation
+		REQUIRE(shared_invoker(shared_userdata.get()) == 16);
+	}
+	REQUIRE(allocations == 0);
+}
+
+TEST_CASE("Test memory_resource") {
+	std::array<int, 16> state {};
+	std::array<unsigned char, 1024> buffer;
+	std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+	auto [userdata, invoker] = functor2c::prefix_invoker_unique(std::allocator_arg, &resource, [state]() { return state.size(); });
+	auto address = reinterpret_cast<unsigned char*>(userdata.get());
+	REQUIRE(address >= buffer.data());
+	REQUIRE(address < buffer.data() + buffer.size());
+	REQUIRE(invoker(userdata.get()) == 16);
+}
+
+TEST_CASE("Test pool_allocator") {
+	std::array<int, 16> state {};
+	functor2c::pool_allocator<char> allocator;
+	auto stats = allocator.thread_stats();
+
+	for (int i = 0; i < 10; i++) {
+		auto [userdata, oneshot_invoker] = functor2c::prefix_invoker_oneshot(std::allocator_arg, allocator, [state](int i) { return state[i]; });
+		REQUIRE(oneshot_invoker(userdata, i) == 0);
+	}
+	auto new_stats = allocator.thread_stats();
+	REQUIRE(new_stats.allocations - stats.allocations == 10);
+	REQUIRE(new_stats.hits - stats.hits >= 9);
+
+	// Blocks freed in other threads are returned to their owner thread
+	std::vector<std::tuple<void*, int (*)(void*, int)>> callbacks;
+	for (int i = 0; i < 10; i++) {
+		callbacks.push_back(functor2c::prefix_invoker_oneshot(std::allocator_arg, allocator, [state](int i) { return state[i]; }));
+	}
+	std::thread([&callbacks]() {
+		for (auto& callback : callbacks) {
+			std::get<1>(callback)(std::get<0>(callback), 0);
+		}
+	}).join();
+	stats = allocator.thread_stats();
+	auto [userdata, oneshot_invoker] = functor2c::prefix_invoker_oneshot(std::allocator_arg, allocator, [state](int i) { return state[i]; });
+	oneshot_invoker(userdata, 0);
+	new_stats = allocator.thread_stats();
+	REQUIRE(new_stats.remote_frees - stats.remote_frees >= 10);
+	REQUIRE(new_stats.hits - stats.hits == 1);
+}
+
+TEST_CASE("Test arena") {
+	int destroyed = 0;
+	struct counted {
+		int *destroyed;
+		std::array<int, 32> values;
+		int operator()(int i) const {
+			return values[i];
+		}
+		~counted() {
+			++*destroyed;
+		}
+	};
+
+	functor2c::arena arena(256);
+	for (int frame = 0; frame < 3; frame++) {
+		std::vector<std::tuple<void*, int (*)(void*, int)>> callbacks;
+		for (int i = 0; i < 8; i++) {
+			callbacks.push_back(arena.prefix_invoker(counted { &destroyed, { i } }));
+		}
+		auto [invoker, userdata] = arena.suffix_invoker<int, int>([frame](int i) { return frame + i; });
+		REQUIRE(invoker(1, userdata) == frame + 1);
+		for (int i = 0; i < 8; i++) {
+			REQUIRE(std::get<1>(callbacks[i])(std::get<0>(callbacks[i]), 0) == i);
+		}
+
+		destroyed = 0;
+		arena.reset();
+		REQUIRE(destroyed == 8);
+	}
+}
+
+TEST_CASE("Test Refcounted") {
+	int destroyed = 0;
+	struct counted {
+		int *destroyed;
+		std::array<int, 4> values;
+		int operator()(int i) const {
+			return values[i];
+		}
+		~counted() {
+			++*destroyed;
+		}
+	};
+
+	auto [userdata, invoker, retain, release] = functor2c::prefix_invoker_refcounted(counted { &destroyed, { 42 } });
+	destroyed = 0;
+	retain(userdata);
+	REQUIRE(invoker(userdata, 0) == 42);
+	release(userdata);
+	REQUIRE(destroyed == 0);
+	release(userdata);
+	REQUIRE(destroyed == 1);
+
+	auto [suffix_invoker, suffix_userdata, suffix_retain, suffix_release] = functor2c::suffix_invoker_refcounted<int, int>(functor2c::nonatomic_refcount(), counted { &destroyed, { 1 } });
+	destroyed = 0;
+	suffix_retain(suffix_userdata);
+	suffix_release(suffix_userdata);
+	REQUIRE(suffix_invoker(0, suffix_userdata) == 1);
+	suffix_release(suffix_userdata);
+	REQUIRE(destroyed == 1);
+}
+
+namespace {
+struct copy_counter {
+	int *copies;
+	int *moves;
+
+	copy_counter(int *copies, int *moves) : copies(copies), moves(moves) {}
+	copy_counter(const copy_counter& other) : copies(other.copies), moves(other.moves) {
+		++*copies;
+	}
+	copy_counter(copy_counter&& other) : copies(other.copies), moves(other.moves) {
+		++*moves;
+	}
+	void operator()() const {}
+};
+}
+
+TEST_CASE("Test move-only functors") {
+	auto value = std::make_unique<int>(42);
+	auto [userdata, invoker] = functor2c::prefix_invoker_unique([value = std::move(value)]() {
+		return *value;
+	});
+	REQUIRE(invoker(userdata.get()) == 42);
+
+	auto [oneshot_invoker, oneshot_userdata] = functor2c::suffix_invoker_oneshot<int>([value = std::make_unique<int>(1)]() {
+		return *value;
+	});
+	REQUIRE(oneshot_invoker(oneshot_userdata) == 1);
+}
+
+TEST_CASE("Test functors are forwarded") {
+	int copies = 0, moves = 0;
+	copy_counter counter(&copies, &moves);
+
+	auto [userdata, invoker, deleter] = functor2c::prefix_invoker_deleter(counter);
+	REQUIRE(copies == 1);
+	REQUIRE(moves == 0);
+	deleter(userdata);
+
+	copies = moves = 0;
+	auto [unique_userdata, unique_invoker] = functor2c::prefix_invoker_unique<void>(counter);
+	REQUIRE(copies == 1);
+	REQUIRE(moves == 0);
+
+	copies = moves = 0;
+	auto [shared_invoker, shared_userdata] = functor2c::suffix_invoker_shared(copy_counter(&copies, &moves));
+	REQUIRE(copies == 0);
+	REQUIRE(moves == 1);
+}
+
+TEST_CASE("Test make from C function type") {
+	typedef void *(*lua_Alloc)(void *ud, void *ptr, size_t osize, size_t nsize);
+	typedef bool custom_filter(int shapeA, int shapeB, void *context);
+
+	int calls = 0;
+	auto [userdata, invoker, deleter] = functor2c::make<lua_Alloc>([&calls](auto ptr, auto, auto) {
+		calls++;
+		return ptr;
+	});
+	lua_Alloc alloc = invoker;
+	REQUIRE(alloc(userdata, &calls, 0, 0) == &calls);
+	deleter(userdata);
+
+	auto [filter_invoker, filter_userdata, filter_deleter] = functor2c::make_suffix<custom_filter*>([&calls](auto a, auto b) {
+		return a + b == calls;
+	});
+	custom_filter *filter = filter_invoker;
+	REQUIRE(filter(0, 1, filter_userdata));
+	filter_deleter(filter_userdata);
+}
+
+namespace {
+int twice(int value) {
+	return value * 2;
+}
+}
+
+TEST_CASE("Test signature deduction") {
+	auto [userdata, invoker, deleter] = functor2c::prefix_invoker_deleter(&twice);
+	REQUIRE(invoker(userdata, 21) == 42);
+	deleter(userdata);
+
+	auto [noexcept_invoker, noexcept_userdata] = functor2c::suffix_invoker_unique([](int value) noexcept { return value + 1; });
+	REQUIRE(noexcept_invoker(41, noexcept_userdata.get()) == 42);
+
+	auto [mutable_userdata, mutable_invoker] = functor2c::prefix_invoker_shared([count = 0](int value) mutable { return count += value; });
+	REQUIRE(mutable_invoker(mutable_userdata.get(), 40) == 40);
+	REQUIRE(mutable_invoker(mutable_userdata.get(), 2) == 42);
+}
+
+TEST_CASE("Test vtable") {
+	std::array<int, 4> values { 1, 2, 3, 4 };
+	auto [userdata, vtable] = functor2c::prefix_invoker_vtable([values](int i) { return values[i]; });
+	REQUIRE(vtable->size >= sizeof(values));
+	REQUIRE(vtable->invoke(userdata, 3) == 4);
+
+	void *copy = vtable->clone(userdata);
+	REQUIRE(copy != userdata);
+	REQUIRE(vtable->invoke(copy, 0) == 1);
+	vtable->destroy(copy);
+	vtable->destroy(userdata);
+
+	// A single vtable exists per functor type
+	auto lambda = [values](int i) { return values[i]; };
+	auto [vtable1, userdata1] = functor2c::suffix_invoker_vtable(lambda);
+	auto [vtable2, userdata2] = functor2c::suffix_invoker_vtable(lambda);
+	REQUIRE(vtable1 == vtable2);
+	vtable1->destroy(userdata1);
+	vtable2->destroy(userdata2);
+
+	auto [move_only_userdata, move_only_vtable] = functor2c::prefix_invoker_vtable([value = std::make_unique<int>(42)]() { return *value; });
+	REQUIRE(move_only_vtable->clone == nullptr);
+	move_only_vtable->destroy(move_only_userdata);
+}
+
+TEST_CASE("Test multicast") {
+	functor2c::multicast<int(int)> on_event;
+	auto [userdata, invoker] = on_event.prefix_invoker();
+	REQUIRE(invoker(userdata, 1) == 0);
+
+	auto tracker = std::make_shared<int>(0);
+	auto first = on_event.subscribe([tracker](int value) { *tracker += value; return 1; });
+	auto second = on_event.subscribe([tracker](int value) { *tracker += value * 10; return 2; });
+	REQUIRE(on_event.size() == 2);
+	REQUIRE(invoker(userdata, 1) == 2);
+	REQUIRE(*tracker == 11);
+	// Old snapshots are freed by writers when no dispatch is in progress
+	REQUIRE(tracker.use_count() == 3);
+
+	REQUIRE(on_event.unsubscribe(second));
+	REQUIRE_FALSE(on_event.unsubscribe(second));
+	auto [suffix_invoker, suffix_userdata] = on_event.suffix_invoker();
+	REQUIRE(suffix_invoker(1, suffix_userdata) == 1);
+	REQUIRE(*tracker == 12);
+
+	on_event.unsubscribe(first);
+	REQUIRE(on_event.size() == 0);
+	REQUIRE(tracker.use_count() == 1);
+}
+
+TEST_CASE("Test multicast reference parameters") {
+	// By value parameters are passed to every handler as the same lvalue
+	functor2c::multicast<void(std::string)> on_text;
+	std::string seen;
+	on_text.subscribe([](std::string& text) { text += "!"; });
+	on_text.subscribe([&seen](const std::string& text) { seen = text; });
+	on_text(std::string("hello"));
+	REQUIRE(seen == "hello!");
+
+	// Rvalue reference parameters are passed on as rvalue references
+	functor2c::multicast<int(std::unique_ptr<int>&&)> on_value;
+	on_value.subscribe([](std::unique_ptr<int>&& value) { return *value; });
+	on_value.subscribe([](const std::unique_ptr<int>& value) { return *value * 2; });
+	auto [userdata, invoker] = on_value.prefix_invoker();
+	REQUIRE(invoker(userdata, std::make_unique<int>(21)) == 42);
+}
+
+TEST_CASE("Test multicast concurrent subscriptions") {
+	functor2c::multicast<void(int)> on_event;
+	std::atomic<int> total(0);
+	on_event.subscribe([&total](int value) { total += value; });
+
+	std::atomic<bool> running(true);
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; i++) {
+		readers.emplace_back([&] {
+			while (running) {
+				on_event(1);
+			}
+		});
+	}
+	while (total == 0) {
+		std::this_thread::yield();
+	}
+	auto tracker = std::make_shared<int>(0);
+	long max_copies = 0;
+	for (int i = 0; i < 1000; i++) {
+		std::array<int, 8> payload {};
+		auto id = on_event.subscribe([payload, tracker](int) {});
+		// Snapshots being dispatched are only freed once readers are done
+		on_event.unsubscribe(id);
+		max_copies = std::max(max_copies, tracker.use_count() - 1);
+	}
+	// Retired snapshots are freed even though dispatching never stops, so at most one per reader is still alive
+	REQUIRE(max_copies <= 4);
+	running = false;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	REQUIRE(on_event.size() == 1);
+	REQUIRE(total > 0);
+}
+
+static functor2c::handle_table<int(int), 4> test_handle_table;
+
+TEST_CASE("Test handle_table") {
+	auto tracker = std::make_shared<int>(0);
+	auto handle = test_handle_table.insert([tracker](int value) { return *tracker += value; });
+	REQUIRE(handle != 0);
+	REQUIRE(test_handle_table.contains(handle));
+	REQUIRE(test_handle_table.invoke(handle, 2) == 2);
+
+	auto invoker = decltype(test_handle_table)::invoke_prefix<test_handle_table>;
+	REQUIRE(invoker(test_handle_table.userdata(handle), 3) == 5);
+
+	// Stale handles are detected, even after their slot is reused
+	REQUIRE(test_handle_table.erase(handle));
+	REQUIRE(tracker.use_count() == 1);
+	REQUIRE_FALSE(test_handle_table.erase(handle));
+	auto reused = test_handle_table.insert([](int value) { return -value; });
+	REQUIRE(reused != handle);
+	REQUIRE_FALSE(test_handle_table.contains(handle));
+	REQUIRE(test_handle_table.invoke(handle, 3) == 0);
+	REQUIRE(test_handle_table.invoke(reused, 3) == -3);
+
+	std::vector<decltype(handle)> handles { reused };
+	for (int i = 1; i < 4; i++) {
+		handles.push_back(test_handle_table.insert([](int value) { return value; }));
+	}
+	REQUIRE_THROWS_AS(test_handle_table.insert([](int value) { return value; }), std::bad_alloc);
+	for (auto h : handles) {
+		REQUIRE(test_handle_table.erase(h));
+	}
+}
+
+TEST_CASE("Test handle_table concurrent insert and erase") {
+	functor2c::handle_table<void(), 64> table;
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; i++) {
+		threads.emplace_back([&table] {
+			for (int j = 0; j < 10000; j++) {
+				auto handle = table.insert([] {});
+				table.invoke(handle);
+				table.erase(handle);
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	std::vector<std::uintptr_t> handles;
+	for (int i = 0; i < 64; i++) {
+		handles.push_back(table.insert([] {}));
+	}
+	REQUIRE_THROWS_AS(table.insert([] {}), std::bad_alloc);
+}
+
+struct deferred_executor {
+	std::vector<std::pair<void (*)(void*), void*>> tasks;
+
+	void execute(void (*function)(void*), void *userdata) {
+		tasks.emplace_back(function, userdata);
+	}
+
+	void run_all() {
+		for (auto& task : tasks) {
+			task.first(task.second);
+		}
+		tasks.clear();
+	}
+};
+
+TEST_CASE("Test async invoker") {
+	std::atomic<int> total(0);
+	{
+		functor2c::thread_pool pool(2);
+		auto [userdata, invoker, deleter] = functor2c::prefix_invoker_async(pool, [&total](int value, std::unique_ptr<int> extra) {
+			total += value + *extra;
+		});
+		for (int i = 0; i < 100; i++) {
+			invoker(userdata, 1, std::make_unique<int>(1));
+		}
+		// The deleter waits for pending calls
+		deleter(userdata);
+		REQUIRE(total == 200);
+	}
+
+	deferred_executor executor;
+	functor2c::async_options options;
+	options.capacity = 2;
+	options.overflow = functor2c::overflow_policy::drop;
+	int calls = 0;
+	auto [suffix_invoker, suffix_userdata, suffix_deleter] = functor2c::suffix_invoker_async<void, int>(executor, [&calls](int value) { calls += value; }, options);
+	for (int i = 0; i < 4; i++) {
+		suffix_invoker(1, suffix_userdata);
+	}
+	REQUIRE(calls == 0);
+	executor.run_all();
+	REQUIRE(calls == 2);
+	suffix_deleter(suffix_userdata);
+
+	options.overflow = functor2c::overflow_policy::run_inline;
+	auto [inline_userdata, inline_invoker, inline_deleter] = functor2c::prefix_invoker_async<void, int>(executor, [&calls](int value) { calls += value; }, options);
+	for (int i = 0; i < 4; i++) {
+		inline_invoker(inline_userdata, 1);
+	}
+	REQUIRE(calls == 4);
+	executor.run_all();
+	REQUIRE(calls == 6);
+	inline_deleter(inline_userdata);
+
+	options.overflow = functor2c::overflow_policy::block;
+	options.max_enqueue_wait = std::chrono::milliseconds(1);
+	auto [block_userdata, block_invoker, block_deleter] = functor2c::prefix_invoker_async<void, int>(executor, [&calls](int value) { calls += value; }, options);
+	for (int i = 0; i < 3; i++) {
+		block_invoker(block_userdata, 1);
+	}
+	executor.run_all();
+	REQUIRE(calls == 8);
+	block_deleter(block_userdata);
+}
+
+struct rejecting_executor {
+	bool execute(void (*)(void*), void*) {
+		return false;
+	}
+};
+
+struct throwing_executor {
+	void execute(void (*)(void*), void*) {
+		throw std::runtime_error("executor failure");
+	}
+};
+
+TEST_CASE("Test async invoker executor overflow") {
+	// Full thread pools reject tasks instead of running them in the calling thread
+	std::atomic<bool> blocked(true);
+	std::atomic<int> ran(0);
+	{
+		functor2c::thread_pool pool(1, 2);
+		pool.execute([](void *flag) {
+			while (*static_cast<std::atomic<bool>*>(flag)) {
+				std::this_thread::yield();
+			}
+		}, &blocked);
+		bool rejected = false;
+		for (int i = 0; i < 8 && !rejected; i++) {
+			rejected = !pool.execute([](void *counter) { ++*static_cast<std::atomic<int>*>(counter); }, &ran);
+		}
+		REQUIRE(rejected);
+		REQUIRE(ran == 0);
+		blocked = false;
+	}
+
+	// Rejected tasks follow the invoker's overflow policy
+	rejecting_executor rejecting;
+	functor2c::async_options options;
+	options.overflow = functor2c::overflow_policy::drop;
+	int calls = 0;
+	auto [drop_userdata, drop_invoker, drop_deleter] = functor2c::prefix_invoker_async<void, int>(rejecting, [&calls](int value) { calls += value; }, options);
+	drop_invoker(drop_userdata, 1);
+	REQUIRE(calls == 0);
+	drop_deleter(drop_userdata);
+
+	options.overflow = functor2c::overflow_policy::run_inline;
+	auto [inline_userdata, inline_invoker, inline_deleter] = functor2c::prefix_invoker_async<void, int>(rejecting, [&calls](int value) { calls += value; }, options);
+	inline_invoker(inline_userdata, 1);
+	REQUIRE(calls == 1);
+	inline_deleter(inline_userdata);
+
+	throwing_executor throwing;
+	auto [throwing_userdata, throwing_invoker, throwing_deleter] = functor2c::prefix_invoker_async<void, int>(throwing, [&calls](int value) { calls += value; });
+	REQUIRE_THROWS_AS(throwing_invoker(throwing_userdata, 1), std::runtime_error);
+	throwing_deleter(throwing_userdata);
+	REQUIRE(calls == 1);
+
+	// The deleter runs calls the executor did not run yet, without waiting for it
+	deferred_executor deferred;
+	auto [deferred_userdata, deferred_invoker, deferred_deleter] = functor2c::prefix_invoker_async<void, int>(deferred, [&calls](int value) { calls += value; });
+	deferred_invoker(deferred_userdata, 1);
+	deferred_invoker(deferred_userdata, 1);
+	deferred_deleter(deferred_userdata);
+	REQUIRE(calls == 3);
+	// Late tasks find nothing to run, and the last one deletes the wrapper
+	deferred.run_all();
+	REQUIRE(calls == 3);
+}
+
+TEST_CASE("Test async invoker released by its own functor") {
+	void *self_userdata = nullptr;
+	void (*self_deleter)(void*) = nullptr;
+	std::atomic<int> released(0);
+	auto release_itself = [&] {
+		self_deleter(self_userdata);
+		released++;
+	};
+	{
+		functor2c::thread_pool pool(1);
+		void (*pool_invoker)(void*);
+		std::tie(self_userdata, pool_invoker, self_deleter) = functor2c::prefix_invoker_async<void>(pool, release_itself);
+		pool_invoker(self_userdata);
+	}
+	REQUIRE(released == 1);
+
+	deferred_executor deferred;
+	auto [userdata, invoker, deleter] = functor2c::prefix_invoker_async<void>(deferred, release_itself);
+	self_userdata = userdata;
+	self_deleter = deleter;
+	invoker(userdata);
+	deferred.run_all();
+	REQUIRE(released == 2);
+}
+
+TEST_CASE("Test realtime invoker") {
+	std::array<float, 4> gains { 0.5f, 1, 1, 2 };
+	// Checks run outside the invoker, since failures throw and realtime functors are noexcept
+	bool was_realtime = false;
+	auto [userdata, invoker, deleter] = functor2c::prefix_invoker_deleter(functor2c::realtime(), [gains, &was_realtime](float *samples, int frames) noexcept {
+		was_realtime = functor2c::in_realtime_invoker();
+		for (int i = 0; i < frames; i++) {
+			samples[i] *= gains[i];
+		}
+	});
+	std::array<float, 4> samples { 2, 2, 2, 2 };
+	invoker(userdata, samples.data(), 4);
+	REQUIRE(was_realtime);
+	REQUIRE(samples == std::array<float, 4> { 1, 2, 2, 4 });
+	REQUIRE(realtime_allocations == 0);
+	REQUIRE_FALSE(functor2c::in_realtime_invoker());
+	deleter(userdata);
+
+	// Allocations inside realtime invokers are trapped
+	auto [suffix_invoker, suffix_userdata] = functor2c::suffix_invoker_unique<void, int>(functor2c::realtime(), [](int size) noexcept {
+		delete[] new (std::nothrow) char[size];
+	});
+	suffix_invoker(16, suffix_userdata.get());
+	REQUIRE(realtime_allocations == 2);
+}
+
+#ifdef FUNCTOR2C_HAS_CLOSURE
+TEST_CASE("Test closure") {
+	std::array<int, 4> order { 3, 1, 0, 2 };
+	functor2c::closure<int(const void*, const void*)> compare([&order](const void *a, const void *b) {
+		return order[*static_cast<const int*>(a)] - order[*static_cast<const int*>(b)];
+	});
+	std::array<int, 4> values { 0, 1, 2, 3 };
+	qsort(values.data(), values.size(), sizeof(int), compare.get());
+	REQUIRE(values == std::array<int, 4> { 2, 1, 3, 0 });
+
+	// Floating point arguments don't use general purpose registers
+	int offset = 10;
+	functor2c::closure<double(double, int, float, long, long, long, long)> mixed([offset](double a, int b, float c, long d, long e, long f, long g) {
+		return a + b + c + d + e + f + g + offset;
+	});
+	REQUIRE(mixed.get()(0.5, 1, 0.25f, 2, 3, 4, 5) == 25.75);
+
+	// Each closure gets its own function pointer
+	std::vector<functor2c::closure<int()>> closures;
+	for (int i = 0; i < 1000; i++) {
+		closures.emplace_back([i] { return i; });
+	}
+	REQUIRE(closures[0].get() != closures[1].get());
+	REQUIRE(closures[999].get()() == 999);
+
+	auto tracker = std::make_shared<int>(0);
+	functor2c::closure<void(int)> moved([tracker](int value) { *tracker = value; });
+	functor2c::closure<void(int)> target(std::move(moved));
+	REQUIRE_FALSE(moved);
+	target.get()(42);
+	REQUIRE(*tracker == 42);
+	target.reset();
+	REQUIRE(tracker.use_count() == 1);
+}
+#endif
+
+TEST_CASE("Test slot_table") {
+	struct tag {};
+	using table = functor2c::slot_table<int(int), 66, tag>;
+	auto [first, release_first] = table::acquire([](int value) { return value + 1; });
+	auto tracker = std::make_shared<int>(10);
+	auto [second, release_second] = table::acquire([tracker](int value) { return value + *tracker; });
+	REQUIRE(first != second);
+	REQUIRE(first(1) == 2);
+	REQUIRE(second(1) == 11);
+
+	release_second();
+	REQUIRE(tracker.use_count() == 1);
+	auto [reused, release_reused] = table::acquire([](int value) { return -value; });
+	REQUIRE(reused == second);
+	REQUIRE(reused(1) == -1);
+
+	// Fill the remaining slots, crossing bitmap words
+	std::vector<void (*)()> releases { release_first, release_reused };
+	for (int i = 2; i < 66; i++) {
+		releases.push_back(std::get<1>(table::acquire([i](int) { return i; })));
+	}
+	REQUIRE_THROWS_AS(table::acquire([](int value) { return value; }), std::bad_alloc);
+	for (auto release : releases) {
+		release();
+	}
+}
+
+TEST_CASE("Test scoped_tls_invoker") {
+	using compare_guard = functor2c::scoped_tls_invoker<int(const void*, const void*)>;
+	int comparisons = 0;
+	auto descending = [&comparisons](const void *a, const void *b) {
+		comparisons++;
+		return *static_cast<const int*>(b) - *static_cast<const int*>(a);
+	};
+	std::array<int, 4> values { 2, 4, 1, 3 };
+	{
+		compare_guard guard(descending);
+		qsort(values.data(), values.size(), sizeof(int), guard.get());
+		REQUIRE(values == std::array<int, 4> { 4, 3, 2, 1 });
+		REQUIRE(comparisons > 0);
+
+		// Nested guards take over until they are destroyed
+		{
+			auto ascending = [](const void *a, const void *b) {
+				return *static_cast<const int*>(a) - *static_cast<const int*>(b);
+			};
+			compare_guard nested(ascending);
+			qsort(values.data(), values.size(), sizeof(int), compare_guard::trampoline);
+			REQUIRE(values == std::array<int, 4> { 1, 2, 3, 4 });
+		}
+		qsort(values.data(), values.size(), sizeof(int), compare_guard::trampoline);
+		REQUIRE(values == std::array<int, 4> { 4, 3, 2, 1 });
+	}
+
+	// Each thread has its own stack
+	auto thread_id = [] { return 1; };
+	functor2c::scoped_tls_invoker<int()> guard(thread_id);
+	int other_result = 0;
+	std::thread([&other_result] {
+		auto other_id = [] { return 2; };
+		functor2c::scoped_tls_invoker<int()> other_guard(other_id);
+		other_result = other_guard.get()();
+	}).join();
+	REQUIRE(other_result == 2);
+	REQUIRE(guard.get()() == 1);
+}
+
+TEST_CASE("Test batch invoker") {
+	float gain = 2;
+	auto [userdata, invoker, batch_invoker, deleter] = functor2c::prefix_invoker_batch([gain](float sample, const float& envelope) {
+		return sample * envelope * gain;
+	});
+	std::array<float, 4> samples { 1, 2, 3, 4 };
+	std::array<float, 4> envelopes { 1, 0.5f, 0.5f, 0 };
+	std::array<float, 4> output {};
+	batch_invoker(userdata, samples.data(), envelopes.data(), samples.size(), output.data());
+	REQUIRE(output == std::array<float, 4> { 2, 2, 3, 0 });
+	REQUIRE(invoker(userdata, 1, 1) == 2);
+	deleter(userdata);
+
+	// Void functors have no output array, and non-const references are passed as mutable arrays
+	auto [void_userdata, void_invoker, void_batch_invoker, void_deleter] = functor2c::prefix_invoker_batch<void, int&, int>([](int& value, int delta) {
+		value += delta;
+	});
+	std::array<int, 3> values { 1, 2, 3 };
+	std::array<int, 3> deltas { 10, 20, 30 };
+	void_batch_invoker(void_userdata, values.data(), deltas.data(), values.size());
+	REQUIRE(values == std::array<int, 3> { 11, 22, 33 });
+	void_deleter(void_userdata);
+
+	// Elements are passed by reference, so they are only copied by functors taking them by value
+	int copies = 0, moves = 0;
+	copy_counter counter(&copies, &moves);
+	std::array<copy_counter, 3> counters { counter, counter, counter };
+	copies = 0;
+	auto [suffix_invoker, suffix_userdata, suffix_batch_invoker, suffix_deleter] = functor2c::suffix_invoker_batch<int, copy_counter, int>([](const copy_counter&, int value) {
+		return value * 2;
+	});
+	std::array<int, 3> results {};
+	suffix_batch_invoker(counters.data(), deltas.data(), counters.size(), results.data(), suffix_userdata);
+	REQUIRE(results == std::array<int, 3> { 20, 40, 60 });
+	REQUIRE(suffix_invoker(counter, 1, suffix_userdata) == 2);
+	REQUIRE(copies == 1);
+	REQUIRE(moves == 0);
+	suffix_deleter(suffix_userdata);
+
+	copies = 0;
+	auto [value_userdata, value_invoker, value_batch_invoker, value_deleter] = functor2c::prefix_invoker_batch<void, copy_counter>([](copy_counter) {});
+	value_batch_invoker(value_userdata, counters.data(), counters.size());
+	REQUIRE(copies == 3);
+	REQUIRE(moves == 0);
+	value_deleter(value_userdata);
+}
+
+TEST_CASE("Test make_many") {
+	auto tracker = std::make_shared<int>(0);
+	std::vector<std::function<int(int)>> functions;
+	for (int i = 0; i < 100; i++) {
+		functions.emplace_back([tracker, i](int value) { return value + i; });
+	}
+	auto [userdatas, count, invoker, deleter] = functor2c::make_many(functions);
+	REQUIRE(count == 100);
+	REQUIRE(tracker.use_count() == 201);
+	for (int i = 0; i < 100; i++) {
+		REQUIRE(invoker(userdatas[i], 1) == i + 1);
+	}
+	// Functors are laid out contiguously
+	REQUIRE(static_cast<char*>(userdatas[1]) - static_cast<char*>(userdatas[0]) == sizeof(std::function<int(int)>));
+	deleter(userdatas);
+	REQUIRE(tracker.use_count() == 101);
+
+	// Rvalue ranges are moved from
+	int copies = 0, moves = 0;
+	std::vector<copy_counter> counters(3, copy_counter(&copies, &moves));
+	copies = 0;
+	auto [suffix_invoker, suffix_userdatas, suffix_count, suffix_deleter] = functor2c::make_many_suffix<void>(std::move(counters));
+	REQUIRE(suffix_count == 3);
+	suffix_invoker(suffix_userdatas[2]);
+	REQUIRE(copies == 0);
+	REQUIRE(moves == 3);
+	suffix_deleter(suffix_userdatas);
+}
+
+enum class parse_status { ok, invalid };
+using on_message_t = int(void*, const char*, const char*, size_t, int);
+
+TEST_CASE("Test make_adapted") {
+	std::vector<std::string> received;
+	auto [userdata, invoker, deleter] = functor2c::make_adapted<on_message_t>([&received](functor2c::lazy_string_view topic, std::string_view payload, int flags) {
+		received.emplace_back(topic.c_str());
+		received.emplace_back(payload);
+		return flags == 0 ? parse_status::ok : parse_status::invalid;
+	});
+	const char payload[] = "hello world";
+	REQUIRE(invoker(userdata, "topic", payload, 5, 0) == 0);
+	REQUIRE(invoker(userdata, nullptr, payload, 0, 1) == 1);
+	REQUIRE(received == std::vector<std::string> { "topic", "hello", "", "" });
+	deleter(userdata);
+
+	// Single C strings also adapt to std::string_view, and results convert implicitly
+	auto [suffix_invoker, suffix_userdata, suffix_deleter] = functor2c::make_adapted_suffix<size_t(const char*, void*)>([](std::string_view str) {
+		return str.size();
+	});
+	REQUIRE(suffix_invoker("four", suffix_userdata) == 4);
+	suffix_deleter(suffix_userdata);
+
+	// Pointers are paired with the next integral argument only when the remaining parameters allow it
+	auto [string_userdata, string_invoker, string_deleter] = functor2c::make_adapted<int(void*, const char*, int)>([](std::string_view str, int extra) {
+		return int(str.size()) + extra;
+	});
+	REQUIRE(string_invoker(string_userdata, "four", 10) == 14);
+	string_deleter(string_userdata);
+
+	// Adapting stateless functors requires no allocation at all
+	auto [empty_userdata, empty_invoker, empty_deleter] = functor2c::make_adapted<size_t(void*, const char*, size_t)>([](std::string_view str) {
+		return str.size();
+	});
+	REQUIRE(empty_userdata == nullptr);
+	REQUIRE(empty_invoker(empty_userdata, "four", 3) == 3);
+	empty_deleter(empty_userdata);
+
+	functor2c::lazy_string_view lazy("abc");
+	REQUIRE_FALSE(lazy.empty());
+	REQUIRE(std::string_view(lazy) == "abc");
+}
+
+static functor2c::handle_table<void(copy_counter), 4> copy_handle_table;
+
+TEST_CASE("Test argument forwarding") {
+	int copies = 0, moves = 0;
+	int calls = 0;
+	// Functors taking arguments by reference see the exact object materialized by the C caller.
+	// Capturing two references makes them too big to be packed into the userdata.
+	auto by_reference = [&calls, &copies](const copy_counter&) { calls += 1 + copies; };
+	auto by_value = [&calls, &copies](copy_counter) { calls += 1 + copies; };
+
+	auto [userdata, invoker, deleter] = functor2c::prefix_invoker_deleter<void, copy_counter>(by_reference);
+	invoker(userdata, copy_counter(&copies, &moves));
+	REQUIRE(copies == 0);
+	REQUIRE(moves == 0);
+	deleter(userdata);
+
+	auto [value_invoker, value_userdata, value_deleter] = functor2c::suffix_invoker_deleter<void, copy_counter>(by_value);
+	value_invoker(copy_counter(&copies, &moves), value_userdata);
+	REQUIRE(copies == 0);
+	REQUIRE(moves == 1);
+	value_deleter(value_userdata);
+
+	moves = 0;
+	auto [realtime_userdata, realtime_invoker, realtime_deleter] = functor2c::prefix_invoker_deleter<void, copy_counter>(functor2c::realtime(), [&calls](const copy_counter&) noexcept { calls++; });
+	realtime_invoker(realtime_userdata, copy_counter(&copies, &moves));
+	realtime_deleter(realtime_userdata);
+
+	auto [slot_function, release] = functor2c::slot_table<void(copy_counter), 1>::acquire(by_reference);
+	slot_function(copy_counter(&copies, &moves));
+	release();
+
+	functor2c::scoped_tls_invoker<void(copy_counter)> guard(by_reference);
+	guard.get()(copy_counter(&copies, &moves));
+
+	auto handle = copy_handle_table.insert(by_reference);
+	decltype(copy_handle_table)::invoke_prefix<copy_handle_table>(copy_handle_table.userdata(handle), copy_counter(&copies, &moves));
+	copy_handle_table.erase(handle);
+
+	functor2c::multicast<void(copy_counter)> on_event;
+	on_event.subscribe(by_reference);
+	on_event.subscribe(by_reference);
+	auto [multicast_userdata, multicast_invoker] = on_event.prefix_invoker();
+	multicast_invoker(multicast_userdata, copy_counter(&copies, &moves));
+
+	REQUIRE(calls == 8);
+	REQUIRE(copies == 0);
+	REQUIRE(moves == 0);
+}